@@ -0,0 +1,65 @@
+#pragma pack_matrix(row_major)
+
+// Mirrors VkDrawIndexedIndirectCommand
+struct DRAW_COMMAND
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int  vertexOffset;
+    uint firstInstance;                                 // also the index of the draw's DRAW_DATA entry
+};
+
+struct DRAW_DATA
+{
+    uint instance;                                      // index into InstanceData
+    uint material;                                      // index into MaterialData
+};
+
+struct INSTANCE_DATA
+{
+    matrix world;                                       // world space transform of one placement
+};
+
+// Every draw of the level in, the visible ones (and how many) out
+[[vk::binding(0)]] StructuredBuffer<DRAW_COMMAND> Commands;
+[[vk::binding(1)]] StructuredBuffer<DRAW_DATA> DrawData;
+[[vk::binding(2)]] StructuredBuffer<INSTANCE_DATA> InstanceData;
+[[vk::binding(3)]] StructuredBuffer<float4> BoundsData;    // mesh space sphere per placement (xyz center, w radius)
+[[vk::binding(4)]] RWStructuredBuffer<DRAW_COMMAND> VisibleCommands;
+[[vk::binding(5)]] RWStructuredBuffer<uint> VisibleCount;
+
+// Mirrors CULL_CONSTANTS from C++
+[[vk::push_constant]]
+cbuffer CULL_CONSTANTS
+{
+    float4 planes[6];                                   // frustum planes, normals point inside
+    uint   drawCount;
+};
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= drawCount)
+        return;
+
+    DRAW_COMMAND command = Commands[id.x];
+    uint instance        = DrawData[command.firstInstance].instance;
+    matrix world         = InstanceData[instance].world;
+    float4 sphere        = BoundsData[instance];
+
+    // Move the sphere into world space, scaling its radius by the largest axis
+    float3 center        = mul(float4(sphere.xyz, 1), world).xyz;
+    float scale          = max(max(dot(world[0].xyz, world[0].xyz), dot(world[1].xyz, world[1].xyz)), dot(world[2].xyz, world[2].xyz));
+    float radius         = sphere.w * sqrt(scale);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius)
+            return;
+    }
+
+    uint slot;
+    InterlockedAdd(VisibleCount[0], 1, slot);
+    VisibleCommands[slot] = command;
+}
@@ -1,5 +1,5 @@
 // Mirror scene data struct in shaders	(OBJ_ATTRIBUTES from C++)
-#define MAX_SUBMESH_PER_DRAW 1024
+#define MAX_POINT_LIGHTS 16
 struct OBJ_ATTRIBUTES
 {
 	float3	Kd;											// diffuse reflectivity
@@ -14,28 +14,18 @@ struct OBJ_ATTRIBUTES
 	uint	illum;										// illumination model
 };
 	
-struct SHADER_MODEL_DATA								// Mirror SHADER_MODEL_DATA from C++
+struct SHADER_SCENE_DATA								// Mirror SHADER_SCENE_DATA from C++
 {
     float3 sunDirection, sunColor, sunAmbient, camPos,  // Light info
 			pointCol;									
 	matrix viewMatrix, projMatrix;						// view info
-	
-	matrix matricies[MAX_SUBMESH_PER_DRAW];				// world space transforms
-	OBJ_ATTRIBUTES materials[MAX_SUBMESH_PER_DRAW];		// color/texture of surface
-    float4 pLightPos[16];								// positions for point lights in the scene
+    float4 pLightPos[MAX_POINT_LIGHTS];					// positions for point lights in the scene
     int lightCount;
 };
 
-// Add a structured buffer for scene data
-StructuredBuffer<SHADER_MODEL_DATA> SceneData;
-
-// To get push constants to work in HLSL you have to prepend to a cbuffer
-[[vk::push_constant]]
-cbuffer MESH_INDEX
-{
-	// now the bytes that were uploaded by the push constant command should overwrite this buffer
-	uint meshID;
-};
+// Add structured buffers for scene data and the scene's materials
+[[vk::binding(0)]] StructuredBuffer<SHADER_SCENE_DATA> SceneData;
+[[vk::binding(2)]] StructuredBuffer<OBJ_ATTRIBUTES> MaterialData;
 
 struct V_OUT
 {
@@ -43,13 +33,14 @@ struct V_OUT
     float3 viewDir      : TEXCOORD1;
     float3 norm			: NORMAL;			// normal in world space, for lighting
     float3 posW			: WORLD;			// position in world space, for lighting
+    nointerpolation uint material : MATERIAL;	// chosen per draw by the vertex shader
 };
 
 float4 main(V_OUT input) : SV_TARGET 
 {	
 	// DIFFUSE
 	// For lambertian, we need the dot product between the surface norm and direction to light(-lightDir), as well as the light ratio
-	float4 diffuseColor = float4(SceneData[0].materials[meshID].Kd.xyz, 1.0f);						// diffuse color if the material (surfaceColor, fragColor)
+	float4 diffuseColor = float4(MaterialData[input.material].Kd.xyz, 1.0f);						// diffuse color if the material (surfaceColor, fragColor)
 	float3 surfaceNorm	= normalize(input.norm);													// re-normalize input norm
     float lightRatio	= saturate(dot(surfaceNorm, -SceneData[0].sunDirection.xyz));				// Get light ratio (direct light)
 	
@@ -63,8 +54,8 @@ float4 main(V_OUT input) : SV_TARGET
 	// SPECULAR
 	float3 viewDir		= normalize(SceneData[0].camPos - input.posW);								// eye (view) direction vector
 	float3 halfVec		= normalize((-SceneData[0].sunDirection.xyz) + viewDir);
-    float4 gloss		= float4(SceneData[0].materials[meshID].Ks, 1.0);
-    float specPow		= SceneData[0].materials[meshID].Ns;
+    float4 gloss		= float4(MaterialData[input.material].Ks, 1.0);
+    float specPow		= MaterialData[input.material].Ns;
 	
 	// Compute intensity
     float3 intensity	= max(pow(saturate(dot(surfaceNorm, halfVec)), specPow), 0.0f);
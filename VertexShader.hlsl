@@ -1,7 +1,7 @@
 #pragma pack_matrix(row_major)
 
 // Mirror scene data struct in shaders	(OBJ_ATTRIBUTES from c++)
-#define MAX_SUBMESH_PER_DRAW 1024
+#define MAX_POINT_LIGHTS 16
 struct OBJ_ATTRIBUTES
 {
     float3  Kd;                                         // diffuse reflectivity
@@ -16,29 +16,31 @@ struct OBJ_ATTRIBUTES
     uint    illum;                                      // illumination model
 };
 	
-struct SHADER_MODEL_DATA							    // Mirror SHADER_MODEL_DATA from C++
+struct SHADER_SCENE_DATA							    // Mirror SHADER_SCENE_DATA from C++
 {
     float3 sunDirection, sunColor, sunAmbient, camPos,  // lighting info
             pointCol;
     matrix viewMatrix, projMatrix;                      // View and projection matrices
-
-    matrix matricies[MAX_SUBMESH_PER_DRAW];             // world space transforms
-    OBJ_ATTRIBUTES materials[MAX_SUBMESH_PER_DRAW];     // color/texture of surface
-    float4 pLightPos [16];                              // positions for point lights in the scene
+    float4 pLightPos [MAX_POINT_LIGHTS];                // positions for point lights in the scene
     int lightCount;
 };
 
-// create structured buffer
-StructuredBuffer<SHADER_MODEL_DATA> SceneData;
+struct INSTANCE_DATA
+{
+    matrix world;                                       // world space transform of one placement
+};
 
-// To get push constants to work in HLSL you have to prepend to a cbuffer
-// now the bytes that were uploaded by the push constant command should overwrite this buffer
-[[vk::push_constant]]
-cbuffer MESH_INDEX
+struct DRAW_DATA
 {
-	uint meshID; // should always be 0 (for use in the vertex shader)
-    // uint materialID to be added in the future (for use in the pixel shader)
+    uint instance;                                      // index into InstanceData
+    uint material;                                      // index into MaterialData
 };
+
+// create structured buffers (per frame scene data, then the scene's instance, material and draw tables)
+[[vk::binding(0)]] StructuredBuffer<SHADER_SCENE_DATA> SceneData;
+[[vk::binding(1)]] StructuredBuffer<INSTANCE_DATA> InstanceData;
+[[vk::binding(2)]] StructuredBuffer<OBJ_ATTRIBUTES> MaterialData;
+[[vk::binding(3)]] StructuredBuffer<DRAW_DATA> DrawData;
  
 // Adjust vertex shader to take in Position, UV, and Normal, and tweak output in main()
 struct V_IN
@@ -46,6 +48,7 @@ struct V_IN
     float3 localPos     : POSITION;
     float3 tex          : TEXCOORD0;
     float3 norm         : NORMAL;
+    uint   instance     : SV_InstanceID;                // includes firstInstance, selects this draw's DrawData entry
 };
 
 // Adjust output so it outputs V_OUT struct
@@ -55,14 +58,18 @@ struct V_OUT
     float3 tex          : TEXCOORD1;
     float3 norm			: NORMAL;			// normal in world space, for lighting
     float3 posW			: WORLD;			// position in world space, for lighting
+    nointerpolation uint material : MATERIAL;	// index into MaterialData for the pixel shader
 };
 
 V_OUT main(V_IN inputVertex)
 {
     V_OUT output = (V_OUT) 0;
     
-	// multiply stuff , set matrices to meshID
-    output.projectedPos = mul(float4(inputVertex.localPos, 1), SceneData[0].matricies[0]);
+	// multiply stuff , each draw reads its placement's world matrix
+    DRAW_DATA draw      = DrawData[inputVertex.instance];
+    matrix world        = InstanceData[draw.instance].world;
+    output.material     = draw.material;
+    output.projectedPos = mul(float4(inputVertex.localPos, 1), world);
     
     // Save the normal's world position before it gets moved into view/projection space (for normals)
 	output.posW			= output.projectedPos.xyz;	
@@ -71,7 +78,7 @@ V_OUT main(V_IN inputVertex)
 	output.tex		    = inputVertex.tex;
 
 	//  Get normal into world space
-	output.norm			= mul(float4(inputVertex.norm, 0), SceneData[0].matricies[0]).xyz;		// output normal = inputNorm * world (putting it into world space)
+	output.norm			= mul(float4(inputVertex.norm, 0), world).xyz;		// output normal = inputNorm * world (putting it into world space)
 
     return output;
 }
\ No newline at end of file
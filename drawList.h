@@ -0,0 +1,273 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "meshCache.h"
+#include "gpuTable.h"
+#include "uploadRing.h"
+#include "sphereSet.h"
+#include "gpuTimer.h"
+#include "sceneDescriptors.h"
+
+// Expects SHADER_SCENE_DATA (model.h) to be defined before this header
+
+// Which placement and material a draw uses, the shaders index this by SV_InstanceID
+// (each draw's firstInstance points at its own entry)
+struct DRAW_DATA
+{
+	uint32_t					instance;									// into the instance table
+	uint32_t					material;									// into the material table
+};
+
+// Every draw of the level, built once per level.
+// Instances, materials and per-draw data live in scene-wide tables behind a single descriptor set (the renderer's
+// shared layout, see SceneDescriptors), so the
+// whole scene can be submitted with one vkCmdDrawIndexedIndirect over a prebuilt command buffer.
+// The direct path issues one instanced vkCmdDrawIndexed per (model, submesh) from the same tables.
+class DrawList
+{
+	// Scene-wide tables
+	GpuTable<GW::MATH::GMATRIXF>	m_instances;							// world space transform per placement
+	GpuTable<H2B::ATTRIBUTES>		m_materials;							// every material of every mesh
+	GpuTable<DRAW_DATA>				m_draws;								// one per (placement, submesh)
+	GpuTable<GW::MATH::GVECTORF>	m_bounds;								// local bounding sphere (xyz center, w radius) per placement
+	SphereSet						m_worldSpheres;							// the same spheres in world space, for CPU culling
+
+	// Direct path: one instanced draw per (model, submesh), its instances' DRAW_DATA entries are consecutive
+	std::vector<VkDrawIndexedIndirectCommand> m_batches;
+	std::vector<uint32_t>			m_batchInstances;						// first placement of each batch (its model's)
+	std::vector<uint32_t>			m_batchScopes;							// GPU timer scope of each timed batch ("batch <index>")
+
+	// Indirect path: one single-instance command per DRAW_DATA entry, uploaded once per level
+	std::vector<VkDrawIndexedIndirectCommand> m_commands;
+	VkBuffer						m_commandBuffer		= nullptr;
+	GPU_ALLOCATION					m_commandData;
+
+	// What the device lets us do with indirect draws
+	bool							m_indirect			= false;			// drawIndirectFirstInstance
+	bool							m_multiDraw			= false;			// multiDrawIndirect
+	uint32_t						m_maxDrawCount		= 1;
+
+	// One set for the whole scene (every table is static, the scene block comes in through a dynamic offset),
+	// from the renderer's shared pool
+	std::vector<VkDescriptorSet>	m_descriptorSet;
+
+public:
+	// Add every placement of a mesh (after it was uploaded, its arena offsets are baked into the commands)
+	void AddModel(const MeshAsset &_mesh, const std::vector<GW::MATH::GMATRIXF> &_instances)
+	{
+		uint32_t instanceBase	= m_instances.Count();
+		uint32_t materialBase	= m_materials.Count();
+		uint32_t instanceCount	= static_cast<uint32_t>(_instances.size());
+
+		const H2B::BOUNDS &b		= _mesh.data.bounds;
+		GW::MATH::GVECTORF sphere	= { b.center.x, b.center.y, b.center.z, b.radius };
+		for (auto &w : _instances)
+		{
+			m_instances.Push(w);
+			m_bounds.Push(sphere);
+			m_worldSpheres.Push(&b.center.x, b.radius, w);
+		}
+		for (int i = 0; i < _mesh.data.materialCount; ++i)
+			m_materials.Push(_mesh.data.materials[i].attrib);
+
+		for (auto &sub : _mesh.data.meshes)
+		{
+			VkDrawIndexedIndirectCommand draw	= {};
+			draw.indexCount						= sub.drawInfo.indexCount;
+			draw.instanceCount					= instanceCount;
+			draw.firstIndex						= _mesh.firstIndex + sub.drawInfo.indexOffset;
+			draw.vertexOffset					= static_cast<int32_t>(_mesh.firstVertex);
+			draw.firstInstance					= m_draws.Count();
+			m_batches.push_back(draw);
+			m_batchInstances.push_back(instanceBase);
+
+			draw.instanceCount					= 1;
+			for (uint32_t i = 0; i < instanceCount; ++i)
+			{
+				draw.firstInstance				= m_draws.Count();
+				m_commands.push_back(draw);
+				m_draws.Push({ instanceBase + i, materialBase + sub.materialIndex });
+			}
+		}
+	}
+
+	// Create the tables and the command buffer (queued on _staging when they live in device-only memory,
+	// the caller submits it before the first draw)
+	void Create(GpuAllocator &_allocator, StagingBatch &_staging)
+	{
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures(_allocator.GetPhysicalDevice(), &features);
+		m_indirect		= features.drawIndirectFirstInstance == VK_TRUE;
+		m_multiDraw		= features.multiDrawIndirect == VK_TRUE;
+		m_maxDrawCount	= m_multiDraw ? _allocator.GetLimits().maxDrawIndirectCount : 1;
+
+		m_instances.Create(_allocator, _staging);
+		m_materials.Create(_allocator, _staging);
+		m_draws.Create(_allocator, _staging);
+		m_bounds.Create(_allocator, _staging);
+
+		bool deviceLocal					= _allocator.HasDeviceOnlyMemory();
+		VkMemoryPropertyFlags properties	= deviceLocal ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		VkDeviceSize size					= sizeof(VkDrawIndexedIndirectCommand) * (std::max)(m_commands.size(), size_t(1));
+		_allocator.CreateBuffer(size,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			properties, &m_commandBuffer, &m_commandData);
+
+		VkDeviceSize used					= sizeof(VkDrawIndexedIndirectCommand) * m_commands.size();
+		if (m_commandData.mapped)
+			memcpy(m_commandData.mapped, m_commands.data(), static_cast<size_t>(used));
+		else
+			_staging.Add(m_commandBuffer, 0, m_commands.data(), used);
+
+		if (!m_indirect)
+			std::cout << "DrawList: drawIndirectFirstInstance not supported, using direct draws" << std::endl;
+	}
+
+	// Register a timer scope for each batch up front, as many as _timer has room for (the rest aren't timed),
+	// so timing batches costs no lookups while recording
+	void CreateScopes(GpuTimer &_timer)
+	{
+		m_batchScopes.clear();
+		for (uint32_t i = 0; i < m_batches.size(); ++i)
+		{
+			uint32_t scope = _timer.Scope(("batch " + std::to_string(i)).c_str());
+			if (scope == GpuTimer::INVALID_SCOPE)
+				break;
+			m_batchScopes.push_back(scope);
+		}
+	}
+
+	// Scene data at binding 0 (dynamic offset into the upload ring), then the instance, material and draw tables,
+	// in a set from the renderer's shared pool (it holds one per level slot). False if it had none left,
+	// the level can't be drawn then (see HasDescriptors)
+	bool CreateDescriptors(VkDevice &_device, SceneDescriptors &_descriptors, const UploadRing &_upload)
+	{
+		m_descriptorSet										= _descriptors.Allocate(1);
+		if (m_descriptorSet.empty())
+			return false;
+
+		const uint32_t count								= SceneDescriptors::BINDING_COUNT;
+		VkWriteDescriptorSet writeDescriptorSet[count]		= {};
+		VkDescriptorBufferInfo dbufferInfo[count]			= {};
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			writeDescriptorSet[i].sType						= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSet[i].descriptorCount			= 1;
+			writeDescriptorSet[i].dstBinding				= i;
+			writeDescriptorSet[i].descriptorType			= SceneDescriptors::Type(i);
+			writeDescriptorSet[i].pBufferInfo				= &dbufferInfo[i];
+		}
+		dbufferInfo[0]										= { _upload.GetBuffer(), 0, sizeof(SHADER_SCENE_DATA) };
+		dbufferInfo[1]										= { m_instances.GetBuffer(), 0, VK_WHOLE_SIZE };
+		dbufferInfo[2]										= { m_materials.GetBuffer(), 0, VK_WHOLE_SIZE };
+		dbufferInfo[3]										= { m_draws.GetBuffer(), 0, VK_WHOLE_SIZE };
+		for (uint32_t i = 0; i < count; ++i)
+			writeDescriptorSet[i].dstSet					= m_descriptorSet[0];
+		vkUpdateDescriptorSets(_device, count, writeDescriptorSet, 0, nullptr);
+		return true;
+	}
+
+	bool HasDescriptors() const { return !m_descriptorSet.empty(); }
+
+	bool SupportsIndirect() const { return m_indirect; }
+
+	// Used by the FrustumCuller
+	const std::vector<VkDrawIndexedIndirectCommand> &GetCommands() const { return m_commands; }
+	VkBuffer GetCommandBuffer() const { return m_commandBuffer; }
+	const GpuTable<GW::MATH::GMATRIXF> &GetInstances() const { return m_instances; }
+	const GpuTable<DRAW_DATA> &GetDraws() const { return m_draws; }
+	const GpuTable<GW::MATH::GVECTORF> &GetBounds() const { return m_bounds; }
+	const SphereSet &GetWorldSpheres() const { return m_worldSpheres; }
+
+	// Draws submitted by the last Draw call
+	uint32_t DrawCount(bool _indirect) const
+	{
+		return static_cast<uint32_t>(_indirect && m_indirect ? m_commands.size() : m_batches.size());
+	}
+
+	// Bind the tables and this frame's scene block (nothing to bind without descriptors, the caller must not draw then)
+	void Bind(VkPipelineLayout _pipelineLayout, VkCommandBuffer _commandBuffer, uint32_t _sceneOffset)
+	{
+		if (m_descriptorSet.empty())
+			return;
+		vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			_pipelineLayout, 0, 1, &m_descriptorSet[0], 1, &_sceneOffset);
+	}
+
+	// Draw _count commands from _buffer, in as few calls as maxDrawIndirectCount allows
+	void DrawIndirect(VkCommandBuffer _commandBuffer, VkBuffer _buffer, uint32_t _count)
+	{
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		for (uint32_t first = 0; first < _count; first += m_maxDrawCount)
+		{
+			vkCmdDrawIndexedIndirect(_commandBuffer, _buffer, VkDeviceSize(stride) * first,
+				(std::min)(m_maxDrawCount, _count - first), stride);
+		}
+	}
+
+	// Draw the whole scene, with one indirect call or one direct call per batch. Returns the number of draws.
+	// _visibleInstances (one flag per placement) skips batches none of whose placements are visible (direct path only)
+	// _timer times each direct batch that got a scope in CreateScopes
+	uint32_t Draw(VkCommandBuffer _commandBuffer, bool _indirect, const uint8_t* _visibleInstances = nullptr, GpuTimer* _timer = nullptr)
+	{
+		if (_indirect && m_indirect)
+		{
+			DrawIndirect(_commandBuffer, m_commandBuffer, static_cast<uint32_t>(m_commands.size()));
+			return static_cast<uint32_t>(m_commands.size());
+		}
+
+		return DrawBatches(_commandBuffer, 0, static_cast<uint32_t>(m_batches.size()), _visibleInstances, _timer);
+	}
+
+	// Direct draws of batches [_first, _end) only, so the batches can be split across command buffers.
+	// Records nothing but into _commandBuffer (and _timer), so disjoint ranges may be recorded concurrently without a timer.
+	uint32_t DrawBatches(VkCommandBuffer _commandBuffer, uint32_t _first, uint32_t _end, const uint8_t* _visibleInstances = nullptr,
+		GpuTimer* _timer = nullptr) const
+	{
+		uint32_t drawn = 0;
+		for (uint32_t i = _first; i < _end; ++i)
+		{
+			const VkDrawIndexedIndirectCommand &b = m_batches[i];
+			if (_visibleInstances && !AnyVisible(_visibleInstances + m_batchInstances[i], b.instanceCount))
+				continue;
+			bool timed = _timer && i < m_batchScopes.size();
+			if (timed)
+				_timer->Begin(_commandBuffer, m_batchScopes[i]);
+			vkCmdDrawIndexed(_commandBuffer, b.indexCount, b.instanceCount, b.firstIndex, b.vertexOffset, b.firstInstance);
+			if (timed)
+				_timer->End(_commandBuffer, m_batchScopes[i]);
+			++drawn;
+		}
+		return drawn;
+	}
+
+	// Gives the descriptor sets back to the shared pool
+	void CleanUp(GpuAllocator &_allocator, SceneDescriptors &_descriptors)
+	{
+		m_instances.CleanUp(_allocator);
+		m_materials.CleanUp(_allocator);
+		m_draws.CleanUp(_allocator);
+		m_bounds.CleanUp(_allocator);
+		if (m_commandBuffer)
+			_allocator.DestroyBuffer(m_commandBuffer, m_commandData);
+		m_worldSpheres.Clear();
+		m_batches.clear();
+		m_batchInstances.clear();
+		m_batchScopes.clear();
+		m_commands.clear();
+		_descriptors.Free(m_descriptorSet);
+	}
+
+private:
+	static bool AnyVisible(const uint8_t* _flags, uint32_t _count)
+	{
+		for (uint32_t i = 0; i < _count; ++i)
+		{
+			if (_flags[i])
+				return true;
+		}
+		return false;
+	}
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+// How many frames the CPU may record ahead of the GPU, independent of the swapchain's image count.
+// Every frame gets a context index for its per-frame resources (upload ring slice, table copies, query pool,
+// command pools...) and Begin waits on that context's fence before any of them is touched again.
+// The frame itself is submitted by the surface (Gateware's EndFrame), so the fence rides on an empty
+// submission made when the next frame begins: a fence signalled by vkQueueSubmit also covers everything
+// submitted to the queue before it.
+class FrameContexts
+{
+	VkDevice						m_device			= nullptr;
+	VkQueue							m_queue				= nullptr;
+	std::vector<VkFence>			m_fences;							// per context
+	std::vector<uint64_t>			m_frames;							// per context, the frame its fence marks the end of
+	uint32_t						m_current			= 0;
+	uint64_t						m_frame				= 0;			// frames begun, the current one's number
+	uint64_t						m_completed			= 0;			// every frame up to this one is done on the GPU
+	double							m_lastWait			= 0.0;
+	double							m_totalWait			= 0.0;
+
+public:
+	void Create(VkDevice _device, VkQueue _queue, uint32_t _framesInFlight)
+	{
+		m_device							= _device;
+		m_queue								= _queue;
+		VkFenceCreateInfo fenceInfo			= {};
+		fenceInfo.sType						= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags						= VK_FENCE_CREATE_SIGNALED_BIT;			// nothing to wait for the first time round
+		m_fences.resize((std::max)(_framesInFlight, 1u));
+		for (auto& f : m_fences)
+			vkCreateFence(_device, &fenceInfo, nullptr, &f);
+		m_frames.assign(m_fences.size(), 0);
+	}
+
+	uint32_t Count() const { return static_cast<uint32_t>(m_fences.size()); }
+
+	// Once per frame before anything is recorded: marks the end of the previous frame on the queue, then waits
+	// until the last frame that used the next context is done. Returns that context's index.
+	uint32_t Begin()
+	{
+		if (m_frame > 0)
+			vkQueueSubmit(m_queue, 0, nullptr, m_fences[m_current]);		// reset when the previous frame began
+
+		m_current							= static_cast<uint32_t>(m_frame % m_fences.size());
+		++m_frame;
+
+		auto start							= std::chrono::steady_clock::now();
+		vkWaitForFences(m_device, 1, &m_fences[m_current], VK_TRUE, UINT64_MAX);
+		m_lastWait							= std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_totalWait							+= m_lastWait;
+		vkResetFences(m_device, 1, &m_fences[m_current]);
+
+		m_completed							= (std::max)(m_completed, m_frames[m_current]);
+		m_frames[m_current]					= m_frame;
+		return m_current;
+	}
+
+	// Number of the frame being recorded (from 1), and the newest frame known to be finished on the GPU
+	uint64_t Frame() const { return m_frame; }
+	uint64_t Completed() const { return m_completed; }
+
+	// Time the last Begin blocked on the GPU, and its average over every frame, in milliseconds
+	double WaitMilliseconds() const { return m_lastWait; }
+	double AverageWaitMilliseconds() const { return m_frame ? m_totalWait / m_frame : 0.0; }
+
+	// The queue must be idle
+	void CleanUp()
+	{
+		for (auto& f : m_fences)
+			vkDestroyFence(m_device, f, nullptr);
+		m_fences.clear();
+		m_frames.clear();
+	}
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+
+// Frame timing percentiles over the recent history, in milliseconds
+struct FRAME_STATS
+{
+	double		p50		= 0;
+	double		p95		= 0;
+	double		p99		= 0;
+	double		max		= 0;
+	uint32_t	samples	= 0;
+};
+
+// Frame timer on std::chrono::steady_clock (replaces the Win32-only XTime), with the same
+// Signal/Delta/SmoothDelta/Throttle surface (times in seconds). Every Signal also records the frame time
+// in a fixed ring that other threads may read without locking while the owning thread keeps signalling.
+class FrameTimer
+{
+	using CLOCK = std::chrono::steady_clock;
+	static const uint32_t			HISTORY				= 1024;			// frames kept for Stats, a power of two
+	static const uint32_t			MAX_SAMPLES			= 64;			// deltas kept for SmoothDelta
+
+	CLOCK::time_point				m_start;
+	CLOCK::time_point				m_last;
+	double							m_totalTime			= 0.0;
+	double							m_deltaTime			= 0.0;
+	double							m_smoothDelta		= 0.0;
+	double							m_blendWeight		= 0.75;
+	uint32_t						m_numSamples		= 10;
+
+	// Newest delta first, for the weighted average
+	double							m_deltas[MAX_SAMPLES] = {};
+	uint32_t						m_deltaCount		= 0;
+
+	// Signals per second, re-evaluated ten times per second
+	double							m_samplesPerSecond	= 0.0;
+	double							m_lastSecond		= 0.0;
+	uint32_t						m_elapsedSignals	= 0;
+
+	// Single writer (Signal), any number of readers (Stats)
+	std::atomic<float>				m_history[HISTORY];
+	std::atomic<uint32_t>			m_written{ 0 };
+
+public:
+	// _samples previous deltas feed SmoothDelta, each one weighted _smoothFactor times the one after it
+	FrameTimer(uint32_t _samples = 10, double _smoothFactor = 0.75)
+	{
+		m_numSamples	= std::min(std::max(_samples, 1u), MAX_SAMPLES);
+		m_blendWeight	= _smoothFactor;
+		for (auto& h : m_history)
+			h.store(0.0f, std::memory_order_relaxed);
+		Restart();
+	}
+	FrameTimer(const FrameTimer&) = delete;
+	FrameTimer& operator=(const FrameTimer&) = delete;
+
+	// Clears every signal, the total time and the frame history
+	void Restart()
+	{
+		m_start = m_last			= CLOCK::now();
+		m_totalTime = m_deltaTime = m_smoothDelta = m_lastSecond = m_samplesPerSecond = 0.0;
+		m_deltaCount = m_elapsedSignals = 0;
+		m_written.store(0, std::memory_order_release);
+	}
+
+	// Time from Restart to the last Signal (the same all frame)
+	double TotalTime() const { return m_totalTime; }
+
+	// Time from Restart to now
+	double TotalTimeExact() const { return Seconds(CLOCK::now() - m_start); }
+
+	// Marks the end of a frame, once per frame
+	void Signal()
+	{
+		CLOCK::time_point now	= CLOCK::now();
+		m_deltaTime				= Seconds(now - m_last);
+		m_totalTime				= Seconds(now - m_start);
+		m_last					= now;
+
+		// Weighted running average, newest first
+		std::copy_backward(m_deltas, m_deltas + MAX_SAMPLES - 1, m_deltas + MAX_SAMPLES);
+		m_deltas[0]				= m_deltaTime;
+		m_deltaCount			= std::min(m_deltaCount + 1, MAX_SAMPLES);
+		double totalValue = 0, totalWeight = 0, runningWeight = 1;
+		for (uint32_t i = 0; i < std::min(m_numSamples, m_deltaCount); ++i)
+		{
+			totalValue			+= m_deltas[i] * runningWeight;
+			totalWeight			+= runningWeight;
+			runningWeight		*= m_blendWeight;
+		}
+		m_smoothDelta			= totalValue / totalWeight;
+
+		// Publish the slot before the count that makes it visible
+		uint32_t written		= m_written.load(std::memory_order_relaxed);
+		m_history[written & (HISTORY - 1)].store(float(m_deltaTime * 1000.0), std::memory_order_relaxed);
+		m_written.store(written + 1, std::memory_order_release);
+
+		++m_elapsedSignals;
+		double sinceLast		= m_totalTime - m_lastSecond;
+		if (sinceLast >= 0.1)
+		{
+			m_samplesPerSecond	= m_elapsedSignals / sinceLast;
+			m_lastSecond		= m_totalTime;
+			m_elapsedSignals	= 0;
+		}
+	}
+
+	// Time between the last two signals
+	double Delta() const { return m_deltaTime; }
+
+	// Weighted average of the recent deltas (better for motion)
+	double SmoothDelta() const { return m_smoothDelta; }
+
+	// Frame rate
+	double SamplesPerSecond() const { return m_samplesPerSecond; }
+
+	// Sleeps until this thread signals no faster than _targetHz (0 disables it), once per frame like Signal
+	void Throttle(double _targetHz)
+	{
+		if (_targetHz <= 1)
+			return;
+		unsigned int slow = 0;
+		while (m_elapsedSignals / (TotalTimeExact() - m_lastSecond) > _targetHz)
+			std::this_thread::sleep_for(std::chrono::milliseconds(slow++));
+	}
+
+	// Percentiles of the last HISTORY frame times, safe to call from any thread
+	FRAME_STATS Stats() const
+	{
+		FRAME_STATS stats;
+		uint32_t written		= m_written.load(std::memory_order_acquire);
+		uint32_t count			= std::min(written, HISTORY);
+		if (count == 0)
+			return stats;
+
+		float times[HISTORY];
+		for (uint32_t i = 0; i < count; ++i)
+			times[i]			= m_history[(written - 1 - i) & (HISTORY - 1)].load(std::memory_order_relaxed);
+		std::sort(times, times + count);
+		stats.p50				= times[(count - 1) * 50 / 100];
+		stats.p95				= times[(count - 1) * 95 / 100];
+		stats.p99				= times[(count - 1) * 99 / 100];
+		stats.max				= times[count - 1];
+		stats.samples			= count;
+		return stats;
+	}
+
+private:
+	static double Seconds(CLOCK::duration _duration) { return std::chrono::duration<double>(_duration).count(); }
+};
@@ -0,0 +1,374 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include "gpuAllocator.h"
+#include "drawList.h"
+#include "gpuTimer.h"
+
+// Push constants of the cull compute shader (mirrored in CullShader.hlsl)
+struct CULL_CONSTANTS
+{
+	GW::MATH::GVECTORF		planes[6];										// xyz normal pointing inside, w distance
+	uint32_t				drawCount;
+};
+
+// Frustum culls the DrawList's commands every frame and draws only the survivors.
+// On the GPU a compute pass tests each draw's bounding sphere and compacts the visible commands plus a count,
+// which vkCmdDrawIndexedIndirectCount consumes. The CPU path (always available, the only one without
+// draw-indirect-count) tests the world-space spheres with SIMD and writes the visible commands into a host-visible buffer.
+class FrustumCuller
+{
+	PFN_vkCmdDrawIndexedIndirectCountKHR	m_drawIndirectCount	= nullptr;	// null: cull on the CPU
+	uint32_t						m_maxDrawCount		= 1;				// maxDrawIndirectCount
+
+	// Per frame, GPU path: the compacted commands and how many there are (host-visible so the count can be read back)
+	std::vector<VkBuffer>			m_visible;
+	std::vector<GPU_ALLOCATION>		m_visibleData;
+	std::vector<VkBuffer>			m_count;
+	std::vector<GPU_ALLOCATION>		m_countData;
+
+	// Per frame, CPU path: the compacted commands written through the mapping
+	std::vector<VkBuffer>			m_cpuVisible;
+	std::vector<GPU_ALLOCATION>		m_cpuVisibleData;
+	std::vector<uint8_t>			m_instanceVisible;					// one flag per placement, from the last CPU test
+
+	// Compute pass, one command buffer and descriptor set per frame
+	VkCommandPool					m_commandPool		= nullptr;
+	std::vector<VkCommandBuffer>	m_commandBuffers;
+	VkDescriptorSetLayout			m_descriptorLayout	= nullptr;
+	VkDescriptorPool				m_descriptorPool	= nullptr;
+	std::vector<VkDescriptorSet>	m_descriptorSet;
+	VkPipelineLayout				m_pipelineLayout	= nullptr;
+	VkPipeline						m_pipeline			= nullptr;
+
+	uint32_t						m_total				= 0;
+	uint32_t						m_visibleCount		= 0;
+	bool							m_usedGpu			= false;			// which path the last Cull took
+	double							m_cpuMilliseconds	= 0.0;				// time of the last CPU sphere test
+
+public:
+	// Pick the GPU path if draw indirect count was enabled on the device (VK_KHR_draw_indirect_count or the 1.2
+	// drawIndirectCount feature, being exposed isn't enough) and multiDrawIndirect allows more than one draw per call
+	void Init(VkDevice _device, VkPhysicalDevice _physicalDevice, bool _drawIndirectCountEnabled)
+	{
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures(_physicalDevice, &features);
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+		bool multiDraw			= features.multiDrawIndirect == VK_TRUE;
+		m_maxDrawCount			= multiDraw ? properties.limits.maxDrawIndirectCount : 1;
+
+		m_drawIndirectCount		= nullptr;
+		if (_drawIndirectCountEnabled && multiDraw)
+		{
+			m_drawIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+				vkGetDeviceProcAddr(_device, "vkCmdDrawIndexedIndirectCountKHR"));
+			if (m_drawIndirectCount == nullptr)
+				m_drawIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+					vkGetDeviceProcAddr(_device, "vkCmdDrawIndexedIndirectCount"));
+		}
+		if (m_drawIndirectCount == nullptr)
+			std::cout << "FrustumCuller: draw indirect count or multiDrawIndirect not enabled, culling on the CPU" << std::endl;
+	}
+
+	bool OnGpu() const { return m_drawIndirectCount != nullptr; }
+
+	// Whether the last Cull ran the compute pass (its results only live in the GPU buffers Draw reads)
+	bool UsedGpu() const { return m_usedGpu; }
+
+	// Per-level buffers and descriptors, after the DrawList was created
+	void Create(GpuAllocator &_allocator, const DrawList &_drawList, uint32_t _queueFamily, unsigned int _maxFrames)
+	{
+		VkDevice device						= _allocator.GetDevice();
+		m_total								= static_cast<uint32_t>(_drawList.GetCommands().size());
+		m_visibleCount						= m_total;
+
+		m_instanceVisible.assign((_drawList.GetWorldSpheres().Count() + 7) / 8 * 8, 1);
+
+		// The CPU path writes its compacted list through the mapping
+		VkDeviceSize size					= sizeof(VkDrawIndexedIndirectCommand) * (std::max)(m_total, 1u);
+		m_cpuVisible.resize(_maxFrames);
+		m_cpuVisibleData.resize(_maxFrames);
+		for (unsigned int i = 0; i < _maxFrames; ++i)
+		{
+			_allocator.CreateBuffer(size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_cpuVisible[i], &m_cpuVisibleData[i]);
+		}
+		if (!OnGpu())
+			return;
+
+		// The GPU writes its compacted list, only the count has to be readable
+		VkMemoryPropertyFlags properties	= _allocator.HasDeviceOnlyMemory() ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		m_visible.resize(_maxFrames);
+		m_visibleData.resize(_maxFrames);
+		m_count.resize(_maxFrames);
+		m_countData.resize(_maxFrames);
+		for (unsigned int i = 0; i < _maxFrames; ++i)
+		{
+			_allocator.CreateBuffer(size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				properties, &m_visible[i], &m_visibleData[i]);
+			_allocator.CreateBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_count[i], &m_countData[i]);
+			*reinterpret_cast<uint32_t*>(m_countData[i].mapped) = m_total;
+		}
+
+		// Command buffers for the compute pass, submitted ahead of each frame's command buffer
+		VkCommandPoolCreateInfo poolInfo	= {};
+		poolInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags						= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex			= _queueFamily;
+		vkCreateCommandPool(device, &poolInfo, nullptr, &m_commandPool);
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool				= m_commandPool;
+		allocInfo.level						= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount		= _maxFrames;
+		m_commandBuffers.resize(_maxFrames);
+		vkAllocateCommandBuffers(device, &allocInfo, m_commandBuffers.data());
+
+		// 0: all commands, 1: draw table, 2: instance table, 3: bounds, 4: visible commands, 5: visible count
+		VkDescriptorSetLayoutBinding descriptorLayoutBinding[6] = {};
+		for (int i = 0; i < 6; ++i)
+		{
+			descriptorLayoutBinding[i].descriptorCount		= 1;
+			descriptorLayoutBinding[i].descriptorType		= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorLayoutBinding[i].stageFlags			= VK_SHADER_STAGE_COMPUTE_BIT;
+			descriptorLayoutBinding[i].binding				= i;
+		}
+		VkDescriptorSetLayoutCreateInfo descriptorCreateInfo = {};
+		descriptorCreateInfo.sType							= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descriptorCreateInfo.bindingCount					= 6;
+		descriptorCreateInfo.pBindings						= descriptorLayoutBinding;
+		vkCreateDescriptorSetLayout(device, &descriptorCreateInfo, nullptr, &m_descriptorLayout);
+
+		VkDescriptorPoolSize dpSize							= { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 * _maxFrames };
+		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+		descriptorPoolCreateInfo.sType						= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolCreateInfo.poolSizeCount				= 1;
+		descriptorPoolCreateInfo.pPoolSizes					= &dpSize;
+		descriptorPoolCreateInfo.maxSets					= _maxFrames;
+		vkCreateDescriptorPool(device, &descriptorPoolCreateInfo, nullptr, &m_descriptorPool);
+
+		std::vector<VkDescriptorSetLayout> layouts(_maxFrames, m_descriptorLayout);
+		VkDescriptorSetAllocateInfo descriptorAllocInfo		= {};
+		descriptorAllocInfo.sType							= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorAllocInfo.descriptorSetCount				= _maxFrames;
+		descriptorAllocInfo.pSetLayouts						= layouts.data();
+		descriptorAllocInfo.descriptorPool					= m_descriptorPool;
+		m_descriptorSet.resize(_maxFrames);
+		vkAllocateDescriptorSets(device, &descriptorAllocInfo, m_descriptorSet.data());
+
+		VkWriteDescriptorSet writeDescriptorSet[6]			= {};
+		VkDescriptorBufferInfo dbufferInfo[6]				= {};
+		for (int i = 0; i < 6; ++i)
+		{
+			writeDescriptorSet[i].sType						= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSet[i].descriptorCount			= 1;
+			writeDescriptorSet[i].dstBinding				= i;
+			writeDescriptorSet[i].descriptorType			= VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writeDescriptorSet[i].pBufferInfo				= &dbufferInfo[i];
+		}
+		for (unsigned int i = 0; i < _maxFrames; ++i)
+		{
+			dbufferInfo[0]									= { _drawList.GetCommandBuffer(), 0, VK_WHOLE_SIZE };
+			dbufferInfo[1]									= { _drawList.GetDraws().GetBuffer(), 0, VK_WHOLE_SIZE };
+			dbufferInfo[2]									= { _drawList.GetInstances().GetBuffer(), 0, VK_WHOLE_SIZE };
+			dbufferInfo[3]									= { _drawList.GetBounds().GetBuffer(), 0, VK_WHOLE_SIZE };
+			dbufferInfo[4]									= { m_visible[i], 0, VK_WHOLE_SIZE };
+			dbufferInfo[5]									= { m_count[i], 0, VK_WHOLE_SIZE };
+			for (int j = 0; j < 6; ++j)
+				writeDescriptorSet[j].dstSet				= m_descriptorSet[i];
+			vkUpdateDescriptorSets(device, 6, writeDescriptorSet, 0, nullptr);
+		}
+	}
+
+	// Compute pipeline from the compiled CullShader.hlsl (GPU path only), through the renderer's pipeline cache
+	void CreatePipeline(VkDevice _device, VkShaderModule _shader, VkPipelineCache _cache)
+	{
+		if (!OnGpu())
+			return;
+
+		VkPushConstantRange pushConstant					= {};
+		pushConstant.stageFlags								= VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstant.size									= sizeof(CULL_CONSTANTS);
+
+		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
+		pipeline_layout_create_info.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_create_info.setLayoutCount			= 1;
+		pipeline_layout_create_info.pSetLayouts				= &m_descriptorLayout;
+		pipeline_layout_create_info.pushConstantRangeCount	= 1;
+		pipeline_layout_create_info.pPushConstantRanges		= &pushConstant;
+		vkCreatePipelineLayout(_device, &pipeline_layout_create_info, nullptr, &m_pipelineLayout);
+
+		VkComputePipelineCreateInfo pipeline_create_info	= {};
+		pipeline_create_info.sType							= VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_create_info.stage.sType					= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeline_create_info.stage.stage					= VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeline_create_info.stage.module					= _shader;
+		pipeline_create_info.stage.pName					= "main";
+		pipeline_create_info.layout							= m_pipelineLayout;
+		vkCreateComputePipelines(_device, _cache, 1, &pipeline_create_info, nullptr, &m_pipeline);
+	}
+
+	// Cull this frame's draws. Must run before the frame's command buffer is submitted (i.e. inside Render):
+	// the GPU path submits its compute work to _queue ahead of it, the CPU path fills the visible list now.
+	// _viewProjection is the row-vector view * projection matrix.
+	void Cull(unsigned int _frame, const GW::MATH::GMATRIXF &_viewProjection, const DrawList &_drawList, VkQueue _queue, bool _gpu,
+		GpuTimer* _timer = nullptr)
+	{
+		CULL_CONSTANTS constants;
+		ExtractPlanes(_viewProjection, constants.planes);
+		constants.drawCount		= m_total;
+
+		m_usedGpu				= _gpu && OnGpu() && m_total <= m_maxDrawCount;		// one call must cover every draw
+		if (m_usedGpu)
+		{
+			// This frame's previous results are complete (its fence was waited on before the frame started)
+			uint32_t* count		= reinterpret_cast<uint32_t*>(m_countData[_frame].mapped);
+			m_visibleCount		= *count;
+			*count				= 0;
+			RecordAndSubmit(_frame, constants, _queue, _timer);
+			return;
+		}
+
+		// CPU: test every placement, then copy the commands of visible ones into this frame's list
+		TestInstances(constants.planes, _drawList);
+		const auto &commands	= _drawList.GetCommands();
+		const auto &draws		= _drawList.GetDraws();
+		VkDrawIndexedIndirectCommand* out = reinterpret_cast<VkDrawIndexedIndirectCommand*>(m_cpuVisibleData[_frame].mapped);
+		uint32_t visible		= 0;
+		for (uint32_t i = 0; i < m_total; ++i)
+		{
+			if (m_instanceVisible[draws.Get(commands[i].firstInstance).instance])
+				out[visible++]	= commands[i];
+		}
+		m_visibleCount			= visible;
+	}
+
+	// Only test placements (for the direct path, which skips whole batches), see InstanceVisibility
+	void CullInstances(const GW::MATH::GMATRIXF &_viewProjection, const DrawList &_drawList)
+	{
+		GW::MATH::GVECTORF planes[6];
+		ExtractPlanes(_viewProjection, planes);
+		TestInstances(planes, _drawList);
+	}
+
+	// One flag per placement from the last CPU test
+	const uint8_t* InstanceVisibility() const { return m_instanceVisible.data(); }
+
+	// Draw whatever survived this frame's Cull
+	void Draw(VkCommandBuffer _commandBuffer, unsigned int _frame, DrawList &_drawList)
+	{
+		if (m_usedGpu)
+			m_drawIndirectCount(_commandBuffer, m_visible[_frame], 0, m_count[_frame], 0, (std::min)(m_total, m_maxDrawCount),
+				sizeof(VkDrawIndexedIndirectCommand));
+		else
+			_drawList.DrawIndirect(_commandBuffer, m_cpuVisible[_frame], m_visibleCount);
+	}
+
+	// Milliseconds the last CPU sphere test took
+	double CpuMilliseconds() const { return m_cpuMilliseconds; }
+
+	// Draws that passed the test (on the GPU path this is read back when the frame's buffers come around again)
+	uint32_t VisibleCount() const { return m_visibleCount; }
+	uint32_t TotalCount() const { return m_total; }
+
+	void CleanUp(VkDevice &_device, GpuAllocator &_allocator)
+	{
+		for (int i = 0; i < m_visible.size(); ++i)
+		{
+			_allocator.DestroyBuffer(m_visible[i], m_visibleData[i]);
+			_allocator.DestroyBuffer(m_count[i], m_countData[i]);
+		}
+		for (int i = 0; i < m_cpuVisible.size(); ++i)
+			_allocator.DestroyBuffer(m_cpuVisible[i], m_cpuVisibleData[i]);
+		m_visible.clear();
+		m_visibleData.clear();
+		m_count.clear();
+		m_countData.clear();
+		m_cpuVisible.clear();
+		m_cpuVisibleData.clear();
+		m_instanceVisible.clear();
+
+		vkDestroyPipeline(_device, m_pipeline, nullptr);
+		vkDestroyPipelineLayout(_device, m_pipelineLayout, nullptr);
+		vkDestroyDescriptorPool(_device, m_descriptorPool, nullptr);
+		vkDestroyDescriptorSetLayout(_device, m_descriptorLayout, nullptr);
+		vkDestroyCommandPool(_device, m_commandPool, nullptr);		// frees the command buffers
+		m_pipeline			= nullptr;
+		m_pipelineLayout	= nullptr;
+		m_descriptorPool	= nullptr;
+		m_descriptorLayout	= nullptr;
+		m_commandPool		= nullptr;
+		m_commandBuffers.clear();
+		m_descriptorSet.clear();
+	}
+
+	// Planes of a row-vector view * projection (Vulkan clip space, 0 <= z <= w), normals point inside
+	static void ExtractPlanes(const GW::MATH::GMATRIXF &_m, GW::MATH::GVECTORF _planes[6])
+	{
+		auto column = [&](int c) { return GW::MATH::GVECTORF{ _m.data[c], _m.data[4 + c], _m.data[8 + c], _m.data[12 + c] }; };
+		GW::MATH::GVECTORF x = column(0), y = column(1), z = column(2), w = column(3);
+
+		_planes[0] = { w.x + x.x, w.y + x.y, w.z + x.z, w.w + x.w };	// left
+		_planes[1] = { w.x - x.x, w.y - x.y, w.z - x.z, w.w - x.w };	// right
+		_planes[2] = { w.x + y.x, w.y + y.y, w.z + y.z, w.w + y.w };	// bottom
+		_planes[3] = { w.x - y.x, w.y - y.y, w.z - y.z, w.w - y.w };	// top
+		_planes[4] = z;													// near
+		_planes[5] = { w.x - z.x, w.y - z.y, w.z - z.z, w.w - z.w };	// far
+		for (int i = 0; i < 6; ++i)
+		{
+			float length = std::sqrt(_planes[i].x * _planes[i].x + _planes[i].y * _planes[i].y + _planes[i].z * _planes[i].z);
+			_planes[i] = { _planes[i].x / length, _planes[i].y / length, _planes[i].z / length, _planes[i].w / length };
+		}
+	}
+
+private:
+	void TestInstances(const GW::MATH::GVECTORF _planes[6], const DrawList &_drawList)
+	{
+		auto start			= std::chrono::steady_clock::now();
+		_drawList.GetWorldSpheres().Cull(_planes, m_instanceVisible.data());
+		m_cpuMilliseconds	= std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void RecordAndSubmit(unsigned int _frame, const CULL_CONSTANTS &_constants, VkQueue _queue, GpuTimer* _timer)
+	{
+		VkCommandBuffer commandBuffer		= m_commandBuffers[_frame];
+		VkCommandBufferBeginInfo beginInfo	= {};
+		beginInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags						= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		uint32_t scope						= _timer ? _timer->Scope("cull") : GpuTimer::INVALID_SCOPE;
+		if (_timer)
+			_timer->Begin(commandBuffer, scope);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+			0, 1, &m_descriptorSet[_frame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CULL_CONSTANTS), &_constants);
+		vkCmdDispatch(commandBuffer, (m_total + 63) / 64, 1, 1);
+		if (_timer)
+			_timer->End(commandBuffer, scope);
+
+		// The frame's indirect draw (submitted after this) must see the compacted list and count, and the host
+		// reads the count back through the mapping once the frame's fence has signalled
+		VkMemoryBarrier barrier				= {};
+		barrier.sType						= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask				= VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask				= VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo				= {};
+		submitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount		= 1;
+		submitInfo.pCommandBuffers			= &commandBuffer;
+		vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+};
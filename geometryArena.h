@@ -0,0 +1,111 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include "stagingBatch.h"
+#include "rangeAllocator.h"
+
+// Every mesh of the level sub-allocated from one vertex buffer and one index buffer,
+// so the whole scene draws after a single bind
+class GeometryArena
+{
+	VkBuffer			m_vertexBuffer		= nullptr;
+	GPU_ALLOCATION		m_vertexData;
+	VkBuffer			m_indexBuffer		= nullptr;
+	GPU_ALLOCATION		m_indexData;								// mapped only in the host-visible fallback (no device-local heap), where we write directly
+
+	RangeAllocator		m_vertices;								// in vertices
+	RangeAllocator		m_indices;								// in indices
+
+public:
+	// (Re)create both buffers, anything previously allocated is gone
+	void Create(GpuAllocator &_allocator, uint32_t _vertexCapacity, uint32_t _indexCapacity)
+	{
+		CleanUp(_allocator);
+
+		bool deviceLocal					= _allocator.HasDeviceOnlyMemory();
+		VkMemoryPropertyFlags properties	= deviceLocal ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		_allocator.CreateBuffer(sizeof(H2B::VERTEX) * (std::max)(_vertexCapacity, 1u),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			properties, &m_vertexBuffer, &m_vertexData);
+		_allocator.CreateBuffer(sizeof(unsigned int) * (std::max)(_indexCapacity, 1u),
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			properties, &m_indexBuffer, &m_indexData);
+
+		m_vertices.Reset(_vertexCapacity);
+		m_indices.Reset(_indexCapacity);
+	}
+
+	bool IsCreated() const { return m_vertexBuffer != nullptr; }
+
+	// Forget every allocation but keep the buffers (used to compact)
+	void Reset()
+	{
+		m_vertices.Reset(m_vertices.Capacity());
+		m_indices.Reset(m_indices.Capacity());
+	}
+
+	// Reserve room for a mesh, fails without side effects if either buffer is too fragmented or full
+	bool Allocate(uint32_t _vertexCount, uint32_t _indexCount, uint32_t &_firstVertex, uint32_t &_firstIndex)
+	{
+		_firstVertex = m_vertices.Allocate(_vertexCount);
+		if (_firstVertex == RangeAllocator::INVALID)
+			return false;
+		_firstIndex = m_indices.Allocate(_indexCount);
+		if (_firstIndex == RangeAllocator::INVALID)
+		{
+			m_vertices.Free(_firstVertex, _vertexCount);
+			return false;
+		}
+		return true;
+	}
+
+	void Free(uint32_t _firstVertex, uint32_t _vertexCount, uint32_t _firstIndex, uint32_t _indexCount)
+	{
+		m_vertices.Free(_firstVertex, _vertexCount);
+		m_indices.Free(_firstIndex, _indexCount);
+	}
+
+	// Fill an allocated range (copied now in the fallback, queued on _staging otherwise)
+	void Write(StagingBatch &_staging, uint32_t _firstVertex, const H2B::VERTEX* _vertices, uint32_t _vertexCount,
+		uint32_t _firstIndex, const unsigned int* _indices, uint32_t _indexCount)
+	{
+		VkDeviceSize vertexOffset	= sizeof(H2B::VERTEX) * _firstVertex;
+		VkDeviceSize indexOffset	= sizeof(unsigned int) * _firstIndex;
+		VkDeviceSize vertexSize		= sizeof(H2B::VERTEX) * _vertexCount;
+		VkDeviceSize indexSize		= sizeof(unsigned int) * _indexCount;
+
+		if (m_vertexData.mapped)
+		{
+			memcpy(m_vertexData.mapped + vertexOffset, _vertices, static_cast<size_t>(vertexSize));
+			memcpy(m_indexData.mapped + indexOffset, _indices, static_cast<size_t>(indexSize));
+		}
+		else
+		{
+			_staging.Add(m_vertexBuffer, vertexOffset, _vertices, vertexSize);
+			_staging.Add(m_indexBuffer, indexOffset, _indices, indexSize);
+		}
+	}
+
+	// One bind for every mesh in the arena
+	void Bind(VkCommandBuffer _commandBuffer)
+	{
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &m_vertexBuffer, offsets);
+		vkCmdBindIndexBuffer(_commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	uint32_t VertexCapacity() const { return m_vertices.Capacity(); }
+	uint32_t IndexCapacity() const { return m_indices.Capacity(); }
+
+	void CleanUp(GpuAllocator &_allocator)
+	{
+		if (!IsCreated())
+			return;
+		_allocator.DestroyBuffer(m_indexBuffer, m_indexData);
+		_allocator.DestroyBuffer(m_vertexBuffer, m_vertexData);
+	}
+};
@@ -0,0 +1,383 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include "rangeAllocator.h"
+
+// A piece of device memory handed out by GpuAllocator
+struct GPU_ALLOCATION
+{
+	VkDeviceMemory	memory		= nullptr;
+	VkDeviceSize	offset		= 0;				// where the resource starts inside memory
+	VkDeviceSize	size		= 0;				// bytes requested
+	uint8_t*		mapped		= nullptr;			// host pointer to offset (host-visible memory stays mapped)
+	uint32_t		memoryType	= 0;
+	int				sizeClass	= -1;				// >= 0: pooled slot, -1: block range, -2: dedicated
+	uint32_t		block		= 0;				// slab index (pooled) or block index (block range)
+	uint32_t		first		= 0;				// slot index (pooled) or first unit (block range)
+	uint32_t		units		= 0;				// block range length in units
+};
+
+// Device memory sub-allocator.
+// Memory is requested from Vulkan in large blocks per memory type; small resources come from
+// power-of-two size-class pools (slabs of equal slots carved out of a block), larger ones from a
+// free list inside the block, and anything bigger than half a block gets its own allocation.
+// This keeps vkAllocateMemory calls (and maxMemoryAllocationCount) proportional to blocks, not buffers.
+class GpuAllocator
+{
+public:
+	static const VkDeviceSize BLOCK_SIZE	= 64ull * 1024 * 1024;
+	static const VkDeviceSize UNIT			= 256;							// block free list granularity
+	static const VkDeviceSize SLAB_SIZE		= 1024 * 1024;
+	static const int NUM_CLASSES			= 11;							// 256 B .. 256 KB
+
+	struct HEAP_STATS
+	{
+		uint32_t		blockCount			= 0;
+		VkDeviceSize	blockBytes			= 0;						// reserved from Vulkan for blocks
+		uint32_t		dedicatedCount		= 0;
+		VkDeviceSize	dedicatedBytes		= 0;
+		uint32_t		allocationCount		= 0;						// live allocations (all kinds)
+		VkDeviceSize	allocatedBytes		= 0;						// bytes requested by live allocations
+	};
+
+private:
+	struct BLOCK
+	{
+		VkDeviceMemory	memory				= nullptr;
+		uint8_t*		mapped				= nullptr;
+		RangeAllocator	ranges;										// in UNITs
+	};
+	struct SLAB
+	{
+		uint32_t		block				= 0;
+		uint32_t		first				= 0;						// block range backing the slab
+		uint32_t		units				= 0;
+		VkDeviceSize	offset				= 0;						// first slot, aligned to the class size
+		uint32_t		slotCount			= 0;						// 0 once the slab has been released
+		std::vector<uint32_t> freeSlots;
+	};
+	struct MEMORY_TYPE
+	{
+		std::vector<BLOCK>	blocks;
+		std::vector<SLAB>	pools[NUM_CLASSES];
+	};
+
+	VkDevice							m_device			= nullptr;
+	VkPhysicalDevice					m_physicalDevice	= nullptr;
+	VkPhysicalDeviceMemoryProperties	m_memory			= {};
+	VkPhysicalDeviceProperties			m_properties		= {};
+	std::vector<MEMORY_TYPE>			m_types;
+	std::vector<HEAP_STATS>				m_heaps;
+	std::vector<VkDeviceMemory>			m_dedicated;
+
+public:
+	void Create(VkDevice _device, VkPhysicalDevice _physicalDevice)
+	{
+		m_device			= _device;
+		m_physicalDevice	= _physicalDevice;
+		vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &m_memory);
+		vkGetPhysicalDeviceProperties(_physicalDevice, &m_properties);
+		m_types.assign(m_memory.memoryTypeCount, MEMORY_TYPE());
+		m_heaps.assign(m_memory.memoryHeapCount, HEAP_STATS());
+	}
+
+	VkDevice GetDevice() const { return m_device; }
+	VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+	const VkPhysicalDeviceLimits &GetLimits() const { return m_properties.limits; }
+	const HEAP_STATS &GetHeapStats(uint32_t _heap) const { return m_heaps[_heap]; }
+	uint32_t GetHeapCount() const { return m_memory.memoryHeapCount; }
+
+	// Does the device have memory the host can't see? Only then is staging worth it. Lavapipe and integrated
+	// parts also report a DEVICE_LOCAL heap, but all of its memory types are HOST_VISIBLE, so they write directly.
+	bool HasDeviceOnlyMemory() const
+	{
+		for (uint32_t i = 0; i < m_memory.memoryTypeCount; ++i)
+		{
+			VkMemoryPropertyFlags flags = m_memory.memoryTypes[i].propertyFlags;
+			if ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+				return true;
+		}
+		return false;
+	}
+
+	// Create a buffer and bind it to sub-allocated memory (replaces GvkHelper::create_buffer)
+	VkResult CreateBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties,
+		VkBuffer* _buffer, GPU_ALLOCATION* _allocation)
+	{
+		VkBufferCreateInfo bufferInfo	= {};
+		bufferInfo.sType				= VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size					= _size;
+		bufferInfo.usage				= _usage;
+		bufferInfo.sharingMode			= VK_SHARING_MODE_EXCLUSIVE;
+		VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, _buffer);
+		if (result != VK_SUCCESS)
+			return result;
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(m_device, *_buffer, &requirements);
+		result = Allocate(requirements, _properties, *_allocation);
+		if (result != VK_SUCCESS)
+		{
+			vkDestroyBuffer(m_device, *_buffer, nullptr);
+			*_buffer = nullptr;
+			return result;
+		}
+		return vkBindBufferMemory(m_device, *_buffer, _allocation->memory, _allocation->offset);
+	}
+
+	void DestroyBuffer(VkBuffer &_buffer, GPU_ALLOCATION &_allocation)
+	{
+		vkDestroyBuffer(m_device, _buffer, nullptr);
+		_buffer = nullptr;
+		Free(_allocation);
+	}
+
+	VkResult Allocate(const VkMemoryRequirements &_requirements, VkMemoryPropertyFlags _properties, GPU_ALLOCATION &_allocation)
+	{
+		_allocation = GPU_ALLOCATION();
+		if (!FindMemoryType(_requirements.memoryTypeBits, _properties, _allocation.memoryType))
+			return VK_ERROR_FEATURE_NOT_PRESENT;
+
+		VkDeviceSize alignment	= (std::max)(_requirements.alignment, VkDeviceSize(1));
+		VkDeviceSize classSize	= UNIT;
+		int sizeClass			= 0;
+		while (sizeClass < NUM_CLASSES && classSize < (std::max)(_requirements.size, alignment))
+		{
+			classSize <<= 1;
+			++sizeClass;
+		}
+
+		VkResult result;
+		if (sizeClass < NUM_CLASSES)
+			result = AllocatePooled(sizeClass, classSize, _allocation);
+		else if (_requirements.size <= BLOCK_SIZE / 2)
+			result = AllocateRange(_requirements.size, alignment, _allocation);
+		else
+			result = AllocateDedicated(_requirements.size, _allocation);
+		if (result != VK_SUCCESS)
+			return result;
+
+		HEAP_STATS &heap		= HeapOf(_allocation.memoryType);
+		_allocation.size		= _requirements.size;
+		heap.allocationCount	+= 1;
+		heap.allocatedBytes		+= _requirements.size;
+		return VK_SUCCESS;
+	}
+
+	void Free(GPU_ALLOCATION &_allocation)
+	{
+		if (_allocation.memory == nullptr)
+			return;
+
+		MEMORY_TYPE &type = m_types[_allocation.memoryType];
+		if (_allocation.sizeClass >= 0)
+		{
+			// back to the slab, and the slab back to its block once it is empty
+			SLAB &slab = type.pools[_allocation.sizeClass][_allocation.block];
+			slab.freeSlots.push_back(_allocation.first);
+			if (slab.freeSlots.size() == slab.slotCount)
+			{
+				type.blocks[slab.block].ranges.Free(slab.first, slab.units);
+				slab.slotCount = 0;
+				slab.freeSlots.clear();
+			}
+		}
+		else if (_allocation.sizeClass == -1)
+			type.blocks[_allocation.block].ranges.Free(_allocation.first, _allocation.units);
+		else
+		{
+			HEAP_STATS &heap	= HeapOf(_allocation.memoryType);
+			heap.dedicatedCount	-= 1;
+			heap.dedicatedBytes	-= _allocation.size;
+			m_dedicated.erase(std::find(m_dedicated.begin(), m_dedicated.end(), _allocation.memory));
+			vkFreeMemory(m_device, _allocation.memory, nullptr);
+		}
+
+		HEAP_STATS &heap		= HeapOf(_allocation.memoryType);
+		heap.allocationCount	-= 1;
+		heap.allocatedBytes		-= _allocation.size;
+		_allocation				= GPU_ALLOCATION();
+	}
+
+	void PrintStats() const
+	{
+		for (uint32_t i = 0; i < m_heaps.size(); ++i)
+		{
+			const HEAP_STATS &h = m_heaps[i];
+			std::cout << "GpuAllocator heap " << i << ": " << h.allocationCount << " allocations ("
+				<< h.allocatedBytes << " bytes) in " << h.blockCount << " blocks (" << h.blockBytes << " bytes) + "
+				<< h.dedicatedCount << " dedicated (" << h.dedicatedBytes << " bytes)" << std::endl;
+		}
+	}
+
+	// Reports anything still allocated, then returns every block to Vulkan
+	void CleanUp()
+	{
+		for (uint32_t i = 0; i < m_heaps.size(); ++i)
+		{
+			if (m_heaps[i].allocationCount)
+				std::cout << "GpuAllocator: LEAK! heap " << i << " still has " << m_heaps[i].allocationCount
+					<< " allocations (" << m_heaps[i].allocatedBytes << " bytes)" << std::endl;
+		}
+
+		for (auto &t : m_types)
+		{
+			for (auto &b : t.blocks)
+				vkFreeMemory(m_device, b.memory, nullptr);	// implicitly unmaps
+		}
+		for (auto m : m_dedicated)
+			vkFreeMemory(m_device, m, nullptr);
+		m_dedicated.clear();
+		m_types.assign(m_types.size(), MEMORY_TYPE());
+		m_heaps.assign(m_heaps.size(), HEAP_STATS());
+	}
+
+private:
+	HEAP_STATS &HeapOf(uint32_t _memoryType) { return m_heaps[m_memory.memoryTypes[_memoryType].heapIndex]; }
+
+	bool FindMemoryType(uint32_t _typeBits, VkMemoryPropertyFlags _properties, uint32_t &_type) const
+	{
+		for (uint32_t i = 0; i < m_memory.memoryTypeCount; ++i)
+		{
+			if ((_typeBits & (1u << i)) && (m_memory.memoryTypes[i].propertyFlags & _properties) == _properties)
+			{
+				_type = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Ask Vulkan for memory, mapping it for good if the host can see it
+	VkResult AllocateMemory(uint32_t _memoryType, VkDeviceSize _size, VkDeviceMemory &_memory, uint8_t* &_mapped)
+	{
+		VkMemoryAllocateInfo allocInfo	= {};
+		allocInfo.sType					= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize		= _size;
+		allocInfo.memoryTypeIndex		= _memoryType;
+		VkResult result = vkAllocateMemory(m_device, &allocInfo, nullptr, &_memory);
+		if (result != VK_SUCCESS)
+			return result;
+
+		_mapped = nullptr;
+		if (m_memory.memoryTypes[_memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			vkMapMemory(m_device, _memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&_mapped));
+		return VK_SUCCESS;
+	}
+
+	// Reserve _size bytes aligned to _alignment from any block of the type, adding a block if needed
+	VkResult AllocateRange(VkDeviceSize _size, VkDeviceSize _alignment, GPU_ALLOCATION &_allocation)
+	{
+		MEMORY_TYPE &type	= m_types[_allocation.memoryType];
+		VkDeviceSize slack	= _alignment > UNIT ? _alignment - UNIT : 0;	// ranges already start on a UNIT
+		uint32_t units		= static_cast<uint32_t>((_size + slack + UNIT - 1) / UNIT);
+
+		for (uint32_t pass = 0; pass < 2; ++pass)
+		{
+			for (uint32_t b = 0; b < type.blocks.size(); ++b)
+			{
+				uint32_t first = type.blocks[b].ranges.Allocate(units);
+				if (first == RangeAllocator::INVALID)
+					continue;
+
+				VkDeviceSize offset		= (first * UNIT + _alignment - 1) / _alignment * _alignment;
+				_allocation.memory		= type.blocks[b].memory;
+				_allocation.offset		= offset;
+				_allocation.mapped		= type.blocks[b].mapped ? type.blocks[b].mapped + offset : nullptr;
+				_allocation.sizeClass	= -1;
+				_allocation.block		= b;
+				_allocation.first		= first;
+				_allocation.units		= units;
+				return VK_SUCCESS;
+			}
+
+			// nothing fits, grow by one block
+			BLOCK block;
+			VkResult result = AllocateMemory(_allocation.memoryType, BLOCK_SIZE, block.memory, block.mapped);
+			if (result != VK_SUCCESS)
+				return result;
+			block.ranges.Reset(static_cast<uint32_t>(BLOCK_SIZE / UNIT));
+			type.blocks.push_back(block);
+
+			HEAP_STATS &heap	= HeapOf(_allocation.memoryType);
+			heap.blockCount		+= 1;
+			heap.blockBytes		+= BLOCK_SIZE;
+		}
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+
+	VkResult AllocatePooled(int _sizeClass, VkDeviceSize _classSize, GPU_ALLOCATION &_allocation)
+	{
+		std::vector<SLAB> &pool = m_types[_allocation.memoryType].pools[_sizeClass];
+
+		// find a slab with a free slot, or a released slab entry to reuse
+		int slabIndex = -1;
+		for (int i = 0; i < pool.size(); ++i)
+		{
+			if (!pool[i].freeSlots.empty())
+			{
+				slabIndex = i;
+				break;
+			}
+			if (pool[i].slotCount == 0 && slabIndex < 0)
+				slabIndex = i;
+		}
+
+		if (slabIndex < 0 || pool[slabIndex].slotCount == 0)
+		{
+			// carve a new slab out of a block
+			GPU_ALLOCATION range;
+			range.memoryType = _allocation.memoryType;
+			VkResult result = AllocateRange(SLAB_SIZE, _classSize, range);
+			if (result != VK_SUCCESS)
+				return result;
+
+			SLAB slab;
+			slab.block		= range.block;
+			slab.first		= range.first;
+			slab.units		= range.units;
+			slab.offset		= range.offset;
+			slab.slotCount	= static_cast<uint32_t>(SLAB_SIZE / _classSize);
+			for (uint32_t s = slab.slotCount; s > 0; --s)
+				slab.freeSlots.push_back(s - 1);
+
+			if (slabIndex < 0)
+			{
+				slabIndex = static_cast<int>(pool.size());
+				pool.push_back(slab);
+			}
+			else
+				pool[slabIndex] = slab;
+		}
+
+		SLAB &slab				= pool[slabIndex];
+		BLOCK &block			= m_types[_allocation.memoryType].blocks[slab.block];
+		uint32_t slot			= slab.freeSlots.back();
+		slab.freeSlots.pop_back();
+
+		_allocation.memory		= block.memory;
+		_allocation.offset		= slab.offset + _classSize * slot;
+		_allocation.mapped		= block.mapped ? block.mapped + _allocation.offset : nullptr;
+		_allocation.sizeClass	= _sizeClass;
+		_allocation.block		= static_cast<uint32_t>(slabIndex);
+		_allocation.first		= slot;
+		return VK_SUCCESS;
+	}
+
+	VkResult AllocateDedicated(VkDeviceSize _size, GPU_ALLOCATION &_allocation)
+	{
+		VkResult result = AllocateMemory(_allocation.memoryType, _size, _allocation.memory, _allocation.mapped);
+		if (result != VK_SUCCESS)
+			return result;
+		_allocation.offset		= 0;
+		_allocation.sizeClass	= -2;
+		m_dedicated.push_back(_allocation.memory);
+
+		HEAP_STATS &heap		= HeapOf(_allocation.memoryType);
+		heap.dedicatedCount		+= 1;
+		heap.dedicatedBytes		+= _size;
+		return VK_SUCCESS;
+	}
+};
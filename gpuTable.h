@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include "gpuAllocator.h"
+#include "stagingBatch.h"
+
+// CPU array mirrored into one storage buffer, written once when the level is built.
+// Nothing changes a table after that, so every frame in flight reads the same copy: device-only memory filled
+// through the level's staging upload, or host-visible memory written through the mapping when there is none.
+template <typename T>
+class GpuTable
+{
+	std::vector<T>					m_data;				// CPU copy of the table
+	VkBuffer						m_handle	= nullptr;
+	GPU_ALLOCATION					m_memory;
+
+public:
+	// Append before Create (the GPU copy is sized to the element count)
+	void Push(const T &_value) { m_data.push_back(_value); }
+
+	const T &Get(unsigned int _index) const { return m_data[_index]; }
+	unsigned int Count() const { return static_cast<unsigned int>(m_data.size()); }
+	VkBuffer GetBuffer() const { return m_handle; }
+
+	// Create the buffer and fill it, or queue the copy on _staging (the caller submits it before the first draw)
+	void Create(GpuAllocator &_allocator, StagingBatch &_staging)
+	{
+		// never create an empty buffer, Vulkan rejects size 0
+		VkDeviceSize size					= sizeof(T) * (std::max)(Count(), 1u);
+		VkMemoryPropertyFlags properties	= _allocator.HasDeviceOnlyMemory() ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT :
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		_allocator.CreateBuffer(size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			properties, &m_handle, &m_memory);
+
+		VkDeviceSize used					= sizeof(T) * Count();
+		if (m_memory.mapped)
+			std::memcpy(m_memory.mapped, m_data.data(), static_cast<size_t>(used));
+		else
+			_staging.Add(m_handle, 0, m_data.data(), used);
+	}
+
+	void CleanUp(GpuAllocator &_allocator)
+	{
+		if (m_handle)
+			_allocator.DestroyBuffer(m_handle, m_memory);
+		m_handle = nullptr;
+		m_data.clear();
+	}
+};
@@ -0,0 +1,249 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+// GPU time of each named scope in one finished frame, in milliseconds (negative: not recorded that frame)
+struct GPU_FRAME_TIMES
+{
+	uint64_t				frame		= 0;
+	std::vector<double>		scopes;										// indexed like GpuTimer::ScopeName
+};
+
+// Timestamp queries around named scopes, one query pool per frame in flight.
+// BeginFrame reads the frame's previous results without waiting (its fence was waited on before the frame
+// started, whatever isn't available is dropped) and then resets the pool with a tiny submission ahead of the
+// frame, since Gateware's command buffer is already inside the render pass where resets aren't allowed.
+// Scopes may be written into any command buffer submitted after BeginFrame on the same queue.
+class GpuTimer
+{
+	VkDevice						m_device			= nullptr;
+	VkCommandPool					m_commandPool		= nullptr;
+	std::vector<VkCommandBuffer>	m_resetBuffers;						// per frame
+	std::vector<VkQueryPool>		m_pools;							// per frame, two queries per scope
+	std::vector<std::vector<uint8_t>>	m_written;						// per frame, which scopes have both queries recorded
+	std::vector<uint64_t>			m_frameNumbers;						// per frame, the frame its queries belong to
+	std::vector<std::string>		m_names;
+	uint32_t						m_maxScopes			= 0;
+	uint32_t						m_current			= 0;
+	uint64_t						m_frameCount		= 0;
+	uint64_t						m_validMask			= 0;
+	double							m_period			= 0.0;				// nanoseconds per tick
+	GPU_FRAME_TIMES					m_latest;
+	std::ofstream					m_csv;
+	std::vector<GPU_FRAME_TIMES>*	m_sink				= nullptr;			// gets every resolved frame
+
+public:
+	static const uint32_t			INVALID_SCOPE		= ~0u;
+
+	// Returns false (and times nothing) if the queue family has no timestamp support
+	bool Create(VkDevice _device, VkPhysicalDevice _physicalDevice, uint32_t _queueFamily, uint32_t _maxFrames, uint32_t _maxScopes)
+	{
+		m_device							= _device;
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+		uint32_t familyCount				= 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, families.data());
+		uint32_t validBits					= _queueFamily < familyCount ? families[_queueFamily].timestampValidBits : 0;
+		if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f)
+		{
+			std::cout << "GpuTimer: timestamps not supported on the graphics queue" << std::endl;
+			return false;
+		}
+		m_validMask							= validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		m_period							= properties.limits.timestampPeriod;
+		m_maxScopes							= _maxScopes;
+
+		VkQueryPoolCreateInfo queryInfo		= {};
+		queryInfo.sType						= VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType					= VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount				= _maxScopes * 2;
+		m_pools.resize(_maxFrames);
+		for (auto& p : m_pools)
+			vkCreateQueryPool(_device, &queryInfo, nullptr, &p);
+		m_written.assign(_maxFrames, std::vector<uint8_t>(_maxScopes, 0));
+		m_frameNumbers.assign(_maxFrames, 0);
+
+		VkCommandPoolCreateInfo poolInfo	= {};
+		poolInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags						= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex			= _queueFamily;
+		vkCreateCommandPool(_device, &poolInfo, nullptr, &m_commandPool);
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool				= m_commandPool;
+		allocInfo.level						= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount		= _maxFrames;
+		m_resetBuffers.resize(_maxFrames);
+		vkAllocateCommandBuffers(_device, &allocInfo, m_resetBuffers.data());
+		return true;
+	}
+
+	bool IsCreated() const { return !m_pools.empty(); }
+
+	// Collects the frame's last results, then resets its pool (submitted before anything else this frame)
+	void BeginFrame(unsigned int _frame, VkQueue _queue)
+	{
+		if (!IsCreated())
+			return;
+		m_current							= _frame;
+		Resolve(_frame);
+
+		VkCommandBuffer commandBuffer		= m_resetBuffers[_frame];
+		VkCommandBufferBeginInfo beginInfo	= {};
+		beginInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags						= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		vkCmdResetQueryPool(commandBuffer, m_pools[_frame], 0, m_maxScopes * 2);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo				= {};
+		submitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount		= 1;
+		submitInfo.pCommandBuffers			= &commandBuffer;
+		vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE);
+
+		std::fill(m_written[_frame].begin(), m_written[_frame].end(), 0);
+		m_frameNumbers[_frame]				= ++m_frameCount;
+	}
+
+	// Index of a named scope (registered on first use), INVALID_SCOPE once every slot is taken
+	uint32_t Scope(const char* _name)
+	{
+		for (uint32_t i = 0; i < m_names.size(); ++i)
+			if (m_names[i] == _name)
+				return i;
+		if (!IsCreated() || m_names.size() >= m_maxScopes)
+			return INVALID_SCOPE;
+		m_names.push_back(_name);
+		m_latest.scopes.resize(m_names.size(), -1.0);
+		return static_cast<uint32_t>(m_names.size() - 1);
+	}
+
+	// Timestamps at the top and the bottom of the pipe around the commands in between
+	void Begin(VkCommandBuffer _commandBuffer, uint32_t _scope)
+	{
+		if (_scope < m_maxScopes)
+			vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_pools[m_current], _scope * 2);
+	}
+	void End(VkCommandBuffer _commandBuffer, uint32_t _scope)
+	{
+		if (_scope >= m_maxScopes)
+			return;
+		vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_pools[m_current], _scope * 2 + 1);
+		m_written[m_current][_scope]		= 1;
+	}
+
+	// The scope's queries were recorded earlier into a command buffer that is submitted again this frame
+	void Reuse(uint32_t _scope)
+	{
+		if (_scope < m_maxScopes)
+			m_written[m_current][_scope]	= 1;
+	}
+
+	// Most recent frame whose results came back
+	const GPU_FRAME_TIMES& Latest() const { return m_latest; }
+	const std::string& ScopeName(uint32_t _scope) const { return m_names[_scope]; }
+	uint32_t ScopeCount() const { return static_cast<uint32_t>(m_names.size()); }
+
+	// Appends every resolved frame to _sink from now on (nullptr stops)
+	void Collect(std::vector<GPU_FRAME_TIMES>* _sink) { m_sink = _sink; }
+
+	// Resolves every frame still pending, oldest first (only once the device is idle)
+	void ResolveAll()
+	{
+		if (!IsCreated())
+			return;
+		uint32_t frames						= static_cast<uint32_t>(m_pools.size());
+		std::vector<uint32_t> order(frames);
+		for (uint32_t i = 0; i < frames; ++i)
+			order[i]						= i;
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return m_frameNumbers[a] < m_frameNumbers[b]; });
+		for (uint32_t f : order)
+		{
+			Resolve(f);
+			std::fill(m_written[f].begin(), m_written[f].end(), 0);
+		}
+	}
+
+	// Appends "frame,scope,milliseconds" rows for every frame resolved from now on (empty path stops)
+	bool RecordCsv(const char* _path)
+	{
+		if (m_csv.is_open())
+			m_csv.close();
+		if (_path == nullptr || *_path == '\0')
+			return true;
+		m_csv.open(_path, std::ios_base::out | std::ios_base::trunc);
+		if (!m_csv.is_open())
+		{
+			std::cout << "GpuTimer: Could not open \"" << _path << "\"" << std::endl;
+			return false;
+		}
+		m_csv << "frame,scope,ms\n";
+		return true;
+	}
+	bool IsRecording() const { return m_csv.is_open(); }
+
+	// The pools must not be in use any more
+	void CleanUp()
+	{
+		if (m_csv.is_open())
+			m_csv.close();
+		for (auto& p : m_pools)
+			vkDestroyQueryPool(m_device, p, nullptr);
+		if (m_commandPool)
+			vkDestroyCommandPool(m_device, m_commandPool, nullptr);		// frees the command buffers
+		m_pools.clear();
+		m_resetBuffers.clear();
+		m_written.clear();
+		m_frameNumbers.clear();
+		m_commandPool						= nullptr;
+	}
+
+private:
+	void Resolve(unsigned int _frame)
+	{
+		const std::vector<uint8_t>& written	= m_written[_frame];
+		uint32_t scopes						= static_cast<uint32_t>(m_names.size());
+		bool any							= false;
+		for (uint32_t i = 0; i < scopes; ++i)
+			any								= any || written[i];
+		if (!any)
+			return;
+
+		// Value and availability per query, never waits
+		std::vector<uint64_t> results(scopes * 4);
+		vkGetQueryPoolResults(m_device, m_pools[_frame], 0, scopes * 2, results.size() * sizeof(uint64_t), results.data(),
+			sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		GPU_FRAME_TIMES times;
+		times.frame							= m_frameNumbers[_frame];
+		times.scopes.assign(scopes, -1.0);
+		for (uint32_t i = 0; i < scopes; ++i)
+		{
+			const uint64_t* q				= &results[i * 4];
+			if (!written[i])
+				continue;
+			if (q[1] == 0 || q[3] == 0)
+				return;														// not done yet, drop the frame
+			uint64_t ticks					= ((q[2] & m_validMask) - (q[0] & m_validMask)) & m_validMask;
+			times.scopes[i]					= ticks * m_period * 1e-6;
+		}
+		m_latest							= times;
+		if (m_sink)
+			m_sink->push_back(times);
+
+		if (m_csv.is_open())
+		{
+			for (uint32_t i = 0; i < scopes; ++i)
+				if (times.scopes[i] >= 0.0)
+					m_csv << times.frame << ',' << m_names[i] << ',' << times.scopes[i] << '\n';
+		}
+	}
+};
@@ -0,0 +1,140 @@
+#ifndef _H2BMAPPEDASSET_H_
+#define _H2BMAPPEDASSET_H_
+#include <memory>
+#include <cstring>
+#include "h2bParser.h"
+#include "mappedFile.h"
+
+namespace H2B {
+
+	// Read-only array inside someone else's memory
+	template <typename T>
+	struct VIEW {
+		const T* ptr = nullptr;
+		size_t count = 0;
+		const T* data() const { return ptr; }
+		size_t size() const { return count; }
+		const T* begin() const { return ptr; }
+		const T* end() const { return ptr + count; }
+		const T& operator[](size_t i) const { return ptr[i]; }
+	};
+
+	// Same fields as Parser, but nothing is streamed or copied: the vertex and index payloads are views
+	// into a mapped .h2b (or into a .h2b blob inside a mapped level pack), and every name points at its
+	// null terminated string in the mapping. Only the small material/batch/mesh tables are decoded,
+	// since their fields aren't aligned in the file. The asset keeps the mapping alive.
+	class MappedAsset
+	{
+		std::shared_ptr<const MappedFile> file;
+	public:
+		char version[4] = {};
+		unsigned vertexCount = 0;
+		unsigned indexCount = 0;
+		unsigned materialCount = 0;
+		unsigned meshCount = 0;
+		VIEW<VERTEX> vertices;
+		VIEW<unsigned> indices;
+		std::vector<MATERIAL> materials;
+		std::vector<BATCH> batches;
+		std::vector<MESH> meshes;
+		BOUNDS bounds = {};				// of every vertex
+
+		// Maps a standalone .h2b
+		bool Open(const char* h2bPath)
+		{
+			std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+			if (!mapping->Open(h2bPath))
+				return false;
+			return View(mapping, 0, mapping->Size());
+		}
+
+		// Uses _size bytes at _offset of an existing mapping (which must start 4 byte aligned)
+		bool View(std::shared_ptr<const MappedFile> mapping, size_t offset, size_t size)
+		{
+			Clear();
+			if (offset + size > mapping->Size() || (offset & 3) != 0)
+				return false;
+			const uint8_t* base = mapping->Data() + offset;
+			const uint8_t* end = base + size;
+			const uint8_t* cursor = base;
+
+			if (!Read(cursor, end, version, 4))
+				return false;
+			if (version[1] < '1' || version[2] < '9' || version[3] < 'd')
+				return false;
+			if (!Read(cursor, end, &vertexCount, 4) || !Read(cursor, end, &indexCount, 4) ||
+				!Read(cursor, end, &materialCount, 4) || !Read(cursor, end, &meshCount, 4))
+				return false;
+
+			// The payloads directly follow the 20 byte header, so they are 4 byte aligned
+			if (uint64_t(end - cursor) < uint64_t(36) * vertexCount)
+				return false;
+			vertices = { reinterpret_cast<const VERTEX*>(cursor), vertexCount };
+			cursor += size_t(36) * vertexCount;
+			if (uint64_t(end - cursor) < uint64_t(4) * indexCount)
+				return false;
+			indices = { reinterpret_cast<const unsigned*>(cursor), indexCount };
+			cursor += size_t(4) * indexCount;
+
+			materials.resize(materialCount);
+			for (unsigned i = 0; i < materialCount; ++i) {
+				if (!Read(cursor, end, &materials[i].attrib, 80))
+					return false;
+				for (int j = 0; j < 10; ++j) {
+					const char* text = nullptr;
+					if (!String(cursor, end, text))
+						return false;
+					*((&materials[i].name) + j) = text;
+				}
+			}
+			batches.resize(materialCount);
+			if (materialCount && !Read(cursor, end, batches.data(), size_t(8) * materialCount))
+				return false;
+			meshes.resize(meshCount);
+			for (unsigned i = 0; i < meshCount; ++i) {
+				meshes[i] = {};
+				if (!String(cursor, end, meshes[i].name) ||
+					!Read(cursor, end, &meshes[i].drawInfo, 8) || !Read(cursor, end, &meshes[i].materialIndex, 4))
+					return false;
+			}
+			file = std::move(mapping);
+			bounds = ComputeBounds(vertices.data(), vertexCount, indices.data(), indexCount, meshes);
+			return true;
+		}
+
+		void Clear()
+		{
+			file.reset();
+			*reinterpret_cast<unsigned*>(version) = 0;
+			vertexCount = indexCount = materialCount = meshCount = 0;
+			vertices = {};
+			indices = {};
+			materials.clear();
+			batches.clear();
+			meshes.clear();
+			bounds = {};
+		}
+
+	private:
+		static bool Read(const uint8_t*& cursor, const uint8_t* end, void* out, size_t size)
+		{
+			if (size_t(end - cursor) < size)
+				return false;
+			memcpy(out, cursor, size);
+			cursor += size;
+			return true;
+		}
+
+		// Empty strings become nullptr, like Parser
+		static bool String(const uint8_t*& cursor, const uint8_t* end, const char*& out)
+		{
+			const void* terminator = memchr(cursor, '\0', end - cursor);
+			if (terminator == nullptr)
+				return false;
+			out = *cursor ? reinterpret_cast<const char*>(cursor) : nullptr;
+			cursor = static_cast<const uint8_t*>(terminator) + 1;
+			return true;
+		}
+	};
+}
+#endif
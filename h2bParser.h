@@ -3,6 +3,7 @@
 #include <fstream>
 #include <vector>
 #include <set>
+#include <cmath>
 
 namespace H2B {
 
@@ -38,11 +39,63 @@ namespace H2B {
 		const char* bump;
 		const void* padding[2];
 	};
+	struct BOUNDS {
+		VECTOR min, max;		// axis aligned box
+		VECTOR center;			// sphere around the box
+		float radius;
+	};
 	struct MESH {
 		const char* name;
 		BATCH drawInfo;
 		unsigned materialIndex;
+		BOUNDS bounds;			// of the vertices this submesh indexes
+	};
+	// Box grows by each position, the sphere is centered on the box and reaches the farthest position
+	struct BOUNDS_BUILDER {
+		VECTOR lo = { 3.4e38f, 3.4e38f, 3.4e38f }, hi = { -3.4e38f, -3.4e38f, -3.4e38f };
+		void Add(const VECTOR& p) {
+			lo = { p.x < lo.x ? p.x : lo.x, p.y < lo.y ? p.y : lo.y, p.z < lo.z ? p.z : lo.z };
+			hi = { p.x > hi.x ? p.x : hi.x, p.y > hi.y ? p.y : hi.y, p.z > hi.z ? p.z : hi.z };
+		}
+		BOUNDS Box() const {
+			if (lo.x > hi.x)
+				return {};
+			return { lo, hi, { (lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f }, 0.0f };
+		}
+		static void Reach(BOUNDS& b, const VECTOR& p) {
+			float dx = p.x - b.center.x, dy = p.y - b.center.y, dz = p.z - b.center.z;
+			float d = dx * dx + dy * dy + dz * dz;
+			if (d > b.radius)
+				b.radius = d;		// squared, ComputeBounds takes the root
+		}
 	};
+	// Fills each submesh's bounds (over the vertices it indexes) and returns the bounds of every vertex
+	inline BOUNDS ComputeBounds(const VERTEX* vertices, unsigned vertexCount, const unsigned* indices, unsigned indexCount, std::vector<MESH>& meshes)
+	{
+		BOUNDS_BUILDER all;
+		for (unsigned v = 0; v < vertexCount; ++v)
+			all.Add(vertices[v].pos);
+		BOUNDS bounds = all.Box();
+		for (unsigned v = 0; v < vertexCount; ++v)
+			BOUNDS_BUILDER::Reach(bounds, vertices[v].pos);
+		bounds.radius = std::sqrt(bounds.radius);
+
+		for (auto& m : meshes) {
+			unsigned first = m.drawInfo.indexOffset, last = first + m.drawInfo.indexCount;
+			if (last > indexCount)
+				last = indexCount;
+			BOUNDS_BUILDER sub;
+			for (unsigned i = first; i < last; ++i)
+				if (indices[i] < vertexCount)
+					sub.Add(vertices[indices[i]].pos);
+			m.bounds = sub.Box();
+			for (unsigned i = first; i < last; ++i)
+				if (indices[i] < vertexCount)
+					BOUNDS_BUILDER::Reach(m.bounds, vertices[indices[i]].pos);
+			m.bounds.radius = std::sqrt(m.bounds.radius);
+		}
+		return bounds;
+	}
 	class Parser
 	{
 		std::set<std::string> file_strings;
@@ -57,6 +110,7 @@ namespace H2B {
 		std::vector<MATERIAL> materials;
 		std::vector<BATCH> batches;
 		std::vector<MESH> meshes;
+		BOUNDS bounds;				// of every vertex
 		bool Parse(const char* h2bPath)
 		{
 			Clear();
@@ -104,6 +158,9 @@ namespace H2B {
 				file.read(reinterpret_cast<char*>(&meshes[i].drawInfo), 8);
 				file.read(reinterpret_cast<char*>(&meshes[i].materialIndex), 4);
 			}
+			if (file.fail())
+				return false;		// truncated
+			ComputeBounds();
 			return true;
 		}
 		void Clear()
@@ -115,6 +172,12 @@ namespace H2B {
 			materials.clear();
 			batches.clear();
 			meshes.clear();
+			bounds = {};
+		}
+	private:
+		void ComputeBounds()
+		{
+			bounds = H2B::ComputeBounds(vertices.data(), vertexCount, indices.data(), indexCount, meshes);
 		}
 	};
 }
@@ -0,0 +1,238 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include "headlessSurface.h"
+
+// Closed Catmull-Rom spline through camera positions, each with the point it looks at
+class CameraPath
+{
+	struct KEY
+	{
+		GW::MATH::GVECTORF			eye;
+		GW::MATH::GVECTORF			at;
+	};
+	std::vector<KEY>				m_keys;
+
+public:
+	// One key per line: "eyeX eyeY eyeZ atX atY atZ", '#' starts a comment
+	bool Load(const char* _path)
+	{
+		m_keys.clear();
+		std::ifstream file(_path);
+		if (!file.is_open())
+		{
+			std::cout << "CameraPath: Could not open \"" << _path << "\"" << std::endl;
+			return false;
+		}
+		std::string line;
+		while (std::getline(file, line))
+		{
+			line = line.substr(0, line.find('#'));
+			std::istringstream values(line);
+			KEY k = {};
+			if (values >> k.eye.x >> k.eye.y >> k.eye.z >> k.at.x >> k.at.y >> k.at.z)
+				m_keys.push_back(k);
+		}
+		if (m_keys.size() < 2)
+			std::cout << "CameraPath: \"" << _path << "\" needs at least two keys" << std::endl;
+		return m_keys.size() >= 2;
+	}
+
+	// A loop that weaves between the middle and the edge of the box, always looking at its center
+	void AroundBox(const GW::MATH::GVECTORF& _min, const GW::MATH::GVECTORF& _max)
+	{
+		m_keys.clear();
+		GW::MATH::GVECTORF center	= { (_min.x + _max.x) * 0.5f, (_min.y + _max.y) * 0.5f, (_min.z + _max.z) * 0.5f, 1.0f };
+		float radius				= (std::max)((std::max)(_max.x - _min.x, _max.z - _min.z) * 0.5f, 1.0f);
+		float height				= (std::max)(_max.y - _min.y, 1.0f);
+		const int keys				= 8;
+		for (int i = 0; i < keys; ++i)
+		{
+			float angle				= 6.2831853f * i / keys;
+			float r					= radius * (i % 2 ? 0.3f : 0.9f);
+			KEY k;
+			k.eye					= { center.x + r * std::cos(angle), center.y + height * (i % 2 ? 0.2f : 0.6f), center.z + r * std::sin(angle), 1.0f };
+			k.at					= center;
+			m_keys.push_back(k);
+		}
+	}
+
+	// _t in [0, 1) covers the whole loop once
+	void Sample(float _t, GW::MATH::GVECTORF& _eye, GW::MATH::GVECTORF& _at) const
+	{
+		size_t count				= m_keys.size();
+		float scaled				= (_t - std::floor(_t)) * count;
+		size_t i					= static_cast<size_t>(scaled) % count;
+		float f						= scaled - std::floor(scaled);
+		const KEY& p0				= m_keys[(i + count - 1) % count];
+		const KEY& p1				= m_keys[i];
+		const KEY& p2				= m_keys[(i + 1) % count];
+		const KEY& p3				= m_keys[(i + 2) % count];
+		_eye						= CatmullRom(p0.eye, p1.eye, p2.eye, p3.eye, f);
+		_at							= CatmullRom(p0.at, p1.at, p2.at, p3.at, f);
+	}
+
+private:
+	static GW::MATH::GVECTORF CatmullRom(const GW::MATH::GVECTORF& _p0, const GW::MATH::GVECTORF& _p1,
+		const GW::MATH::GVECTORF& _p2, const GW::MATH::GVECTORF& _p3, float _t)
+	{
+		float t2 = _t * _t, t3 = t2 * _t;
+		auto axis = [&](float a, float b, float c, float d)
+		{
+			return 0.5f * (2.0f * b + (c - a) * _t + (2.0f * a - 5.0f * b + 4.0f * c - d) * t2 + (3.0f * b - a - 3.0f * c + d) * t3);
+		};
+		return { axis(_p0.x, _p1.x, _p2.x, _p3.x), axis(_p0.y, _p1.y, _p2.y, _p3.y), axis(_p0.z, _p1.z, _p2.z, _p3.z), 1.0f };
+	}
+};
+
+struct HEADLESS_OPTIONS
+{
+	std::string		level		= "../GameLevel.txt";
+	std::string		cameraPath;									// empty: a loop around the level
+	std::string		csv			= "../HeadlessBench.csv";
+	unsigned int	frames		= 600;
+	unsigned int	warmup		= 30;								// rendered but not written
+	unsigned int	width		= 1280;
+	unsigned int	height		= 720;
+	unsigned int	framesInFlight	= Renderer::DEFAULT_FRAMES_IN_FLIGHT;
+	bool			parallelRecording	= false;					// F7, to compare CPU time with and without it
+};
+
+// Renders options.frames frames of a level offscreen while flying the camera path once, then writes one CSV row
+// per frame: CPU time (Render plus submit), the wait for the image's fence and, inside Render, for the frame context,
+// GPU scene/cull time, draws and uploads.
+// Returns the process exit code.
+inline int RunHeadlessBenchmark(const HEADLESS_OPTIONS& _options)
+{
+	struct ROW
+	{
+		double			cpu		= 0, wait = 0, inFlight = 0;
+		uint32_t		draws	= 0, visible = 0;
+		uint64_t		upload	= 0;
+	};
+	auto milliseconds = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+	HeadlessSurface surface;
+	if (!surface.Create(_options.width, _options.height))
+		return 1;
+	std::cout << "Headless: " << surface.DeviceName() << ", " << _options.width << "x" << _options.height << ", "
+		<< _options.frames << " frames of " << _options.level << ", " << _options.framesInFlight << " in flight" << std::endl;
+
+	std::vector<ROW> rows(_options.warmup + _options.frames);
+	std::vector<GPU_FRAME_TIMES> gpuFrames;
+	uint32_t sceneScope = GpuTimer::INVALID_SCOPE, cullScope = GpuTimer::INVALID_SCOPE;
+	{
+		Renderer renderer(surface, _options.level, _options.framesInFlight);
+		renderer.SetParallelRecording(_options.parallelRecording);
+
+		CameraPath path;
+		if (_options.cameraPath.empty() || !path.Load(_options.cameraPath.c_str()))
+		{
+			GW::MATH::GVECTORF min, max;
+			renderer.GetSceneBounds(min, max);
+			path.AroundBox(min, max);
+		}
+
+		GW::MATH::GMatrix matrices;
+		matrices.Create();
+		VkClearValue clearValues[2];
+		clearValues[0].color			= { {0.0f, 0.0f, 0.0f, 1.0f} };
+		clearValues[1].depthStencil		= { 1.0f, 0u };
+		renderer.SetClearValues(clearValues);
+
+		renderer.CollectGpuFrameTimes(&gpuFrames);
+		for (size_t i = 0; i < rows.size(); ++i)
+		{
+			// Warmup frames hold the first key
+			float t						= i < _options.warmup ? 0.0f : float(i - _options.warmup) / _options.frames;
+			GW::MATH::GVECTORF eye, at, up = { 0.0f, 1.0f, 0.0f, 0.0f };
+			path.Sample(t, eye, at);
+			GW::MATH::GMATRIXF view;
+			matrices.LookAtLHF(eye, at, up, view);
+
+			auto start					= std::chrono::steady_clock::now();
+			if (!surface.StartFrame(2, clearValues))
+				break;
+			auto started				= std::chrono::steady_clock::now();
+			renderer.SetView(view);
+			renderer.Render();
+			surface.EndFrame();
+			auto end					= std::chrono::steady_clock::now();
+
+			rows[i].wait				= milliseconds(started - start);
+			rows[i].cpu					= milliseconds(end - started);
+			rows[i].inFlight			= renderer.GetFrameWaitMilliseconds();
+			rows[i].draws				= renderer.GetFrameDrawCount();
+			rows[i].visible				= renderer.GetFrameVisibleCount();
+			rows[i].upload				= renderer.GetFrameUploadBytes();
+		}
+		renderer.FlushGpuFrameTimes();
+		renderer.CollectGpuFrameTimes(nullptr);
+
+		const GpuTimer& timer			= renderer.GetGpuTimer();
+		for (uint32_t s = 0; s < timer.ScopeCount(); ++s)
+		{
+			if (timer.ScopeName(s) == "scene")
+				sceneScope				= s;
+			else if (timer.ScopeName(s) == "cull")
+				cullScope				= s;
+		}
+		renderer.CleanUp();
+	}
+	surface.CleanUp();
+
+	// GPU frames are numbered from 1 in Render order, so frame i of the run is number i + 1
+	std::vector<double> gpuScene(rows.size(), -1.0), gpuCull(rows.size(), -1.0);
+	for (auto& g : gpuFrames)
+	{
+		if (g.frame == 0 || g.frame > rows.size())
+			continue;
+		if (sceneScope < g.scopes.size())
+			gpuScene[g.frame - 1]		= g.scopes[sceneScope];
+		if (cullScope < g.scopes.size())
+			gpuCull[g.frame - 1]		= g.scopes[cullScope];
+	}
+
+	std::ofstream csv(_options.csv, std::ios_base::out | std::ios_base::trunc);
+	if (!csv.is_open())
+	{
+		std::cout << "Headless: Could not write \"" << _options.csv << "\"" << std::endl;
+		return 1;
+	}
+	csv << "frame,cpu_ms,wait_ms,inflight_wait_ms,gpu_scene_ms,gpu_cull_ms,draws,visible_draws,upload_bytes\n";
+	std::vector<double> cpu;
+	double gpuTotal = 0;
+	uint32_t gpuCount = 0;
+	for (size_t i = _options.warmup; i < rows.size(); ++i)
+	{
+		const ROW& r = rows[i];
+		csv << i - _options.warmup << ',' << r.cpu << ',' << r.wait << ',' << r.inFlight << ',';
+		if (gpuScene[i] >= 0.0)
+			csv << gpuScene[i];
+		csv << ',';
+		if (gpuCull[i] >= 0.0)
+			csv << gpuCull[i];
+		csv << ',' << r.draws << ',' << r.visible << ',' << r.upload << '\n';
+		cpu.push_back(r.cpu);
+		if (gpuScene[i] >= 0.0)
+		{
+			gpuTotal += gpuScene[i];
+			++gpuCount;
+		}
+	}
+
+	if (!cpu.empty())
+	{
+		std::sort(cpu.begin(), cpu.end());
+		std::cout << "Headless: CPU p50 " << cpu[(cpu.size() - 1) / 2] << " ms, p95 " << cpu[(cpu.size() - 1) * 95 / 100]
+			<< " ms, GPU scene avg " << (gpuCount ? gpuTotal / gpuCount : 0.0) << " ms (" << gpuCount << " frames), written to "
+			<< _options.csv << std::endl;
+	}
+	return 0;
+}
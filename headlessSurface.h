@@ -0,0 +1,385 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include "renderSurface.h"
+
+// Offscreen color/depth targets on a Vulkan device of our own, no window system or swapchain involved,
+// so it runs on any ICD (including lavapipe). Mirrors GVulkanSurface's StartFrame/EndFrame: StartFrame waits
+// for the frame's fence and leaves its command buffer inside the render pass, EndFrame submits it.
+class HeadlessSurface : public RenderSurface
+{
+	// One color and one depth target per frame in flight
+	struct FRAME
+	{
+		VkImage						color				= nullptr;
+		VkImage						depth				= nullptr;
+		VkDeviceMemory				colorMemory			= nullptr;
+		VkDeviceMemory				depthMemory			= nullptr;
+		VkImageView					colorView			= nullptr;
+		VkImageView					depthView			= nullptr;
+		VkFramebuffer				framebuffer			= nullptr;
+		VkCommandBuffer				commandBuffer		= nullptr;
+		VkFence						fence				= nullptr;
+	};
+
+	VkInstance						m_instance			= nullptr;
+	VkPhysicalDevice				m_physicalDevice	= nullptr;
+	VkDevice						m_device			= nullptr;
+	VkQueue							m_queue				= nullptr;
+	uint32_t						m_queueFamily		= 0;
+	VkCommandPool					m_commandPool		= nullptr;
+	VkRenderPass					m_renderPass		= nullptr;
+	VkRenderPass					m_continuePass		= nullptr;
+	VkFormat						m_colorFormat		= VK_FORMAT_R8G8B8A8_UNORM;
+	VkFormat						m_depthFormat		= VK_FORMAT_UNDEFINED;
+	std::vector<FRAME>				m_frames;
+	unsigned int					m_current			= 0;
+	unsigned int					m_width				= 0;
+	unsigned int					m_height			= 0;
+	bool							m_drawIndirectCount	= false;
+
+public:
+	HeadlessSurface() = default;
+	HeadlessSurface(const HeadlessSurface&) = delete;
+	HeadlessSurface& operator=(const HeadlessSurface&) = delete;
+	~HeadlessSurface() { CleanUp(); }
+
+	bool Create(unsigned int _width, unsigned int _height, unsigned int _frames = 3)
+	{
+		m_width		= _width;
+		m_height	= _height;
+		if (!CreateDevice() || !CreateRenderPass())
+			return false;
+
+		VkCommandPoolCreateInfo poolInfo	= {};
+		poolInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags						= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex			= m_queueFamily;
+		vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool);
+
+		m_frames.resize(_frames);
+		for (auto& f : m_frames)
+		{
+			if (!CreateTarget(m_colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+					VK_IMAGE_ASPECT_COLOR_BIT, f.color, f.colorMemory, f.colorView) ||
+				!CreateTarget(m_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+					VK_IMAGE_ASPECT_DEPTH_BIT, f.depth, f.depthMemory, f.depthView))
+				return false;
+
+			VkImageView attachments[2]			= { f.colorView, f.depthView };
+			VkFramebufferCreateInfo framebufferInfo = {};
+			framebufferInfo.sType				= VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass			= m_renderPass;
+			framebufferInfo.attachmentCount		= 2;
+			framebufferInfo.pAttachments		= attachments;
+			framebufferInfo.width				= m_width;
+			framebufferInfo.height				= m_height;
+			framebufferInfo.layers				= 1;
+			vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &f.framebuffer);
+
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool				= m_commandPool;
+			allocInfo.level						= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount		= 1;
+			vkAllocateCommandBuffers(m_device, &allocInfo, &f.commandBuffer);
+
+			VkFenceCreateInfo fenceInfo			= {};
+			fenceInfo.sType						= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			fenceInfo.flags						= VK_FENCE_CREATE_SIGNALED_BIT;
+			vkCreateFence(m_device, &fenceInfo, nullptr, &f.fence);
+		}
+		return true;
+	}
+
+	// Waits until the frame's previous submission is done, then begins its command buffer and render pass
+	bool StartFrame(unsigned int _clearCount, const VkClearValue* _clearValues)
+	{
+		FRAME& f							= m_frames[m_current];
+		vkWaitForFences(m_device, 1, &f.fence, VK_TRUE, UINT64_MAX);
+		vkResetFences(m_device, 1, &f.fence);
+
+		vkResetCommandBuffer(f.commandBuffer, 0);
+		VkCommandBufferBeginInfo beginInfo	= {};
+		beginInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags						= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (vkBeginCommandBuffer(f.commandBuffer, &beginInfo) != VK_SUCCESS)
+			return false;
+
+		VkRenderPassBeginInfo passInfo		= {};
+		passInfo.sType						= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		passInfo.renderPass					= m_renderPass;
+		passInfo.framebuffer				= f.framebuffer;
+		passInfo.renderArea					= { { 0, 0 }, { m_width, m_height } };
+		passInfo.clearValueCount			= _clearCount;
+		passInfo.pClearValues				= _clearValues;
+		vkCmdBeginRenderPass(f.commandBuffer, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+		return true;
+	}
+
+	// Ends the render pass and submits, the next StartFrame moves on to the next frame's targets
+	bool EndFrame()
+	{
+		FRAME& f							= m_frames[m_current];
+		vkCmdEndRenderPass(f.commandBuffer);
+		vkEndCommandBuffer(f.commandBuffer);
+
+		VkSubmitInfo submitInfo				= {};
+		submitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount		= 1;
+		submitInfo.pCommandBuffers			= &f.commandBuffer;
+		VkResult result						= vkQueueSubmit(m_queue, 1, &submitInfo, f.fence);
+		m_current							= (m_current + 1) % m_frames.size();
+		return result == VK_SUCCESS;
+	}
+
+	// Name of the device that was picked
+	std::string DeviceName() const
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+		return properties.deviceName;
+	}
+
+	VkDevice Device() const override { return m_device; }
+	VkPhysicalDevice PhysicalDevice() const override { return m_physicalDevice; }
+	VkQueue GraphicsQueue() const override { return m_queue; }
+	unsigned int GraphicsFamily() const override { return m_queueFamily; }
+	VkCommandPool CommandPool() const override { return m_commandPool; }
+	VkRenderPass RenderPass() const override { return m_renderPass; }
+	VkRenderPass ContinuePass() const override { return m_continuePass; }
+	VkFramebuffer Framebuffer(unsigned int _frame) const override { return m_frames[_frame].framebuffer; }
+	unsigned int FrameCount() const override { return static_cast<unsigned int>(m_frames.size()); }
+	unsigned int CurrentFrame() const override { return m_current; }
+	VkCommandBuffer CommandBuffer(unsigned int _frame) const override { return m_frames[_frame].commandBuffer; }
+	unsigned int Width() const override { return m_width; }
+	unsigned int Height() const override { return m_height; }
+	bool DrawIndirectCount() const override { return m_drawIndirectCount; }
+
+	void CleanUp()
+	{
+		if (m_device)
+		{
+			vkDeviceWaitIdle(m_device);
+			for (auto& f : m_frames)
+			{
+				vkDestroyFence(m_device, f.fence, nullptr);
+				vkDestroyFramebuffer(m_device, f.framebuffer, nullptr);
+				vkDestroyImageView(m_device, f.colorView, nullptr);
+				vkDestroyImageView(m_device, f.depthView, nullptr);
+				vkDestroyImage(m_device, f.color, nullptr);
+				vkDestroyImage(m_device, f.depth, nullptr);
+				vkFreeMemory(m_device, f.colorMemory, nullptr);
+				vkFreeMemory(m_device, f.depthMemory, nullptr);
+			}
+			vkDestroyCommandPool(m_device, m_commandPool, nullptr);		// frees the command buffers
+			vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+			vkDestroyRenderPass(m_device, m_continuePass, nullptr);
+			vkDestroyDevice(m_device, nullptr);
+		}
+		if (m_instance)
+			vkDestroyInstance(m_instance, nullptr);
+		m_frames.clear();
+		m_commandPool		= nullptr;
+		m_renderPass		= nullptr;
+		m_continuePass		= nullptr;
+		m_device			= nullptr;
+		m_instance			= nullptr;
+	}
+
+private:
+	// Vulkan 1.2 when the loader has it (core draw indirect count), otherwise 1.0.
+	// Prefers a discrete GPU, then integrated, virtual and finally a CPU implementation.
+	bool CreateDevice()
+	{
+		uint32_t loaderVersion				= VK_API_VERSION_1_0;
+		auto enumerateVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+		if (enumerateVersion)
+			enumerateVersion(&loaderVersion);
+		uint32_t apiVersion					= loaderVersion >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+
+		VkApplicationInfo appInfo			= {};
+		appInfo.sType						= VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName			= "Level Renderer (headless)";
+		appInfo.apiVersion					= apiVersion;
+		VkInstanceCreateInfo instanceInfo	= {};
+		instanceInfo.sType					= VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceInfo.pApplicationInfo		= &appInfo;
+		if (vkCreateInstance(&instanceInfo, nullptr, &m_instance) != VK_SUCCESS)
+		{
+			std::cout << "HeadlessSurface: Could not create a Vulkan instance!" << std::endl;
+			return false;
+		}
+
+		uint32_t deviceCount				= 0;
+		vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
+		std::vector<VkPhysicalDevice> devices(deviceCount);
+		vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
+		const VkPhysicalDeviceType preference[] = { VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU,
+			VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU, VK_PHYSICAL_DEVICE_TYPE_OTHER };
+		for (int p = 0; p < 5 && m_physicalDevice == nullptr; ++p)
+		{
+			for (auto d : devices)
+			{
+				VkPhysicalDeviceProperties properties;
+				vkGetPhysicalDeviceProperties(d, &properties);
+				uint32_t family = 0;
+				if (properties.deviceType == preference[p] && FindGraphicsFamily(d, family))
+				{
+					m_physicalDevice		= d;
+					m_queueFamily			= family;
+					break;
+				}
+			}
+		}
+		if (m_physicalDevice == nullptr)
+		{
+			std::cout << "HeadlessSurface: No Vulkan device with a graphics queue!" << std::endl;
+			return false;
+		}
+
+		// Every supported core feature, like GVulkanSurface (DrawList picks its path from the supported set)
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures(m_physicalDevice, &features);
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+		VkPhysicalDeviceVulkan12Features features12 = {};
+		features12.sType					= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		bool vulkan12						= apiVersion >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2;
+		if (vulkan12)
+		{
+			VkPhysicalDeviceVulkan12Features supported = {};
+			supported.sType					= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+			VkPhysicalDeviceFeatures2 query	= {};
+			query.sType						= VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			query.pNext						= &supported;
+			vkGetPhysicalDeviceFeatures2(m_physicalDevice, &query);
+			features12.drawIndirectCount	= supported.drawIndirectCount;
+		}
+		bool khrIndirectCount				= !vulkan12 && HasExtension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		const char* extensions[]			= { VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME };
+
+		float priority						= 1.0f;
+		VkDeviceQueueCreateInfo queueInfo	= {};
+		queueInfo.sType						= VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex			= m_queueFamily;
+		queueInfo.queueCount				= 1;
+		queueInfo.pQueuePriorities			= &priority;
+		VkDeviceCreateInfo deviceInfo		= {};
+		deviceInfo.sType					= VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext					= vulkan12 ? &features12 : nullptr;
+		deviceInfo.queueCreateInfoCount		= 1;
+		deviceInfo.pQueueCreateInfos		= &queueInfo;
+		deviceInfo.pEnabledFeatures			= &features;
+		deviceInfo.enabledExtensionCount	= khrIndirectCount ? 1 : 0;
+		deviceInfo.ppEnabledExtensionNames	= khrIndirectCount ? extensions : nullptr;
+		if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+		{
+			std::cout << "HeadlessSurface: Could not create the Vulkan device!" << std::endl;
+			return false;
+		}
+		vkGetDeviceQueue(m_device, m_queueFamily, 0, &m_queue);
+		m_drawIndirectCount					= khrIndirectCount || features12.drawIndirectCount == VK_TRUE;
+
+		// First depth format the device can render to
+		const VkFormat depthFormats[]		= { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM };
+		for (VkFormat format : depthFormats)
+		{
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProperties);
+			if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+			{
+				m_depthFormat				= format;
+				break;
+			}
+		}
+		return m_depthFormat != VK_FORMAT_UNDEFINED;
+	}
+
+	static bool FindGraphicsFamily(VkPhysicalDevice _device, uint32_t& _family)
+	{
+		uint32_t count						= 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(_device, &count, nullptr);
+		std::vector<VkQueueFamilyProperties> families(count);
+		vkGetPhysicalDeviceQueueFamilyProperties(_device, &count, families.data());
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			// The cull pass dispatches on the same queue
+			VkQueueFlags needed				= VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+			if ((families[i].queueFlags & needed) == needed)
+			{
+				_family						= i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool HasExtension(const char* _name) const
+	{
+		uint32_t count						= 0;
+		vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &count, nullptr);
+		std::vector<VkExtensionProperties> extensions(count);
+		vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &count, extensions.data());
+		for (auto& e : extensions)
+			if (strcmp(e.extensionName, _name) == 0)
+				return true;
+		return false;
+	}
+
+	// Same clear/store behaviour as the window's pass, but the color target stays an attachment (nothing presents it)
+	bool CreateRenderPass()
+	{
+		m_renderPass						= CreateSurfacePass(m_device, m_colorFormat, m_depthFormat, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, false);
+		m_continuePass						= CreateSurfacePass(m_device, m_colorFormat, m_depthFormat, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+		return m_renderPass && m_continuePass;
+	}
+
+	bool CreateTarget(VkFormat _format, VkImageUsageFlags _usage, VkImageAspectFlags _aspect,
+		VkImage& _image, VkDeviceMemory& _memory, VkImageView& _view)
+	{
+		VkImageCreateInfo imageInfo			= {};
+		imageInfo.sType						= VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType					= VK_IMAGE_TYPE_2D;
+		imageInfo.format					= _format;
+		imageInfo.extent					= { m_width, m_height, 1 };
+		imageInfo.mipLevels					= 1;
+		imageInfo.arrayLayers				= 1;
+		imageInfo.samples					= VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling					= VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage						= _usage;
+		imageInfo.initialLayout				= VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(m_device, &imageInfo, nullptr, &_image) != VK_SUCCESS)
+			return false;
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(m_device, _image, &requirements);
+		VkPhysicalDeviceMemoryProperties memory;
+		vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memory);
+		uint32_t type						= UINT32_MAX;
+		for (uint32_t i = 0; i < memory.memoryTypeCount && type == UINT32_MAX; ++i)
+			if ((requirements.memoryTypeBits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+				type						= i;
+		for (uint32_t i = 0; i < memory.memoryTypeCount && type == UINT32_MAX; ++i)
+			if (requirements.memoryTypeBits & (1u << i))
+				type						= i;
+
+		VkMemoryAllocateInfo allocInfo		= {};
+		allocInfo.sType						= VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize			= requirements.size;
+		allocInfo.memoryTypeIndex			= type;
+		if (type == UINT32_MAX || vkAllocateMemory(m_device, &allocInfo, nullptr, &_memory) != VK_SUCCESS)
+			return false;
+		vkBindImageMemory(m_device, _image, _memory, 0);
+
+		VkImageViewCreateInfo viewInfo		= {};
+		viewInfo.sType						= VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image						= _image;
+		viewInfo.viewType					= VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format						= _format;
+		viewInfo.subresourceRange			= { _aspect, 0, 1, 0, 1 };
+		return vkCreateImageView(m_device, &viewInfo, nullptr, &_view) == VK_SUCCESS;
+	}
+};
@@ -0,0 +1,252 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include "mappedFile.h"
+#include "levelParser.h"
+
+// .lvlpak: a level and every mesh it references in one file, built offline by LevelPacker.
+// Header, instance table, light table, mesh table, names, then the untouched .h2b files.
+// Every section starts on a 16 byte boundary so the tables can be used straight from the mapping.
+#define LEVEL_PACK_VERSION 1
+
+struct LPAK_HEADER
+{
+	char						magic[4];							// "LPAK"
+	uint32_t					version;
+	uint32_t					instanceCount;
+	uint32_t					lightCount;
+	uint32_t					meshCount;
+	uint32_t					instanceOffset;						// byte offsets from the start of the file
+	uint32_t					lightOffset;
+	uint32_t					meshOffset;
+	uint32_t					nameOffset;
+	uint32_t					nameSize;
+	uint32_t					fileSize;							// catches truncated copies
+	uint32_t					padding;
+};
+
+struct LPAK_INSTANCE
+{
+	float						world[16];							// same layout as GMATRIXF
+	uint32_t					mesh;								// index into the mesh table
+	uint32_t					padding[3];
+};
+
+struct LPAK_LIGHT
+{
+	float						position[4];
+};
+
+struct LPAK_MESH
+{
+	uint32_t					nameOffset;							// into the name block (not terminated)
+	uint32_t					nameLength;
+	uint32_t					blobOffset;							// the .h2b file, byte for byte
+	uint32_t					blobSize;
+};
+
+// Maps a .lvlpak and hands out pointers into it, valid until Close() (meshes can share the mapping beyond that)
+class LevelPack
+{
+	std::shared_ptr<MappedFile>	m_file;
+	const LPAK_HEADER*			m_header			= nullptr;
+
+public:
+	bool Open(const std::string& _path)
+	{
+		Close();
+		m_file = std::make_shared<MappedFile>();
+		if (!m_file->Open(_path.c_str()))
+		{
+			m_file.reset();
+			return false;
+		}
+
+		if (!Validate())
+		{
+			std::cout << "LevelPack: Invalid or out of date pack, rebuild it with LevelPacker!\n" << "Path: " << _path << std::endl;
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+		m_file.reset();
+		m_header = nullptr;
+	}
+
+	bool IsOpen() const { return m_header != nullptr; }
+
+	uint32_t InstanceCount() const { return m_header->instanceCount; }
+	uint32_t LightCount() const { return m_header->lightCount; }
+	uint32_t MeshCount() const { return m_header->meshCount; }
+
+	const LPAK_INSTANCE* Instances() const { return reinterpret_cast<const LPAK_INSTANCE*>(m_file->Data() + m_header->instanceOffset); }
+	const LPAK_LIGHT* Lights() const { return reinterpret_cast<const LPAK_LIGHT*>(m_file->Data() + m_header->lightOffset); }
+	const LPAK_MESH* Meshes() const { return reinterpret_cast<const LPAK_MESH*>(m_file->Data() + m_header->meshOffset); }
+
+	std::string MeshName(uint32_t _mesh) const
+	{
+		const LPAK_MESH& mesh = Meshes()[_mesh];
+		return std::string(reinterpret_cast<const char*>(m_file->Data() + m_header->nameOffset + mesh.nameOffset), mesh.nameLength);
+	}
+
+	std::shared_ptr<const MappedFile> Mapping() const { return m_file; }
+	uint32_t MeshBlobOffset(uint32_t _mesh) const { return Meshes()[_mesh].blobOffset; }
+	uint32_t MeshBlobSize(uint32_t _mesh) const { return Meshes()[_mesh].blobSize; }
+
+	// Builds a pack from a parsed text level, reading each mesh from _assetDir/<name>.h2b.
+	// Placements whose mesh can't be read are dropped (with a message), like the text loader does.
+	static bool Write(const std::string& _path, const LEVEL_DATA& _level, const std::string& _assetDir)
+	{
+		std::vector<LPAK_INSTANCE> instances;
+		std::vector<LPAK_MESH> meshes;
+		std::vector<std::vector<char>> blobs;
+		std::string names;
+		std::unordered_map<std::string, uint32_t> meshIndex;
+
+		size_t count = (std::min)(_level.meshNames.size(), _level.meshMatrices.size());
+		for (size_t i = 0; i < count; ++i)
+		{
+			const std::string& name = _level.meshNames[i];
+			auto found = meshIndex.find(name);
+			if (found == meshIndex.end())
+			{
+				std::string assetPath = _assetDir + name + ".h2b";
+				std::ifstream asset{ assetPath, std::ios::in | std::ios::binary | std::ios::ate };
+				if (!asset.is_open())
+				{
+					std::cout << "LevelPack: Could not open mesh, placement dropped!\n" << "Path: " << assetPath << std::endl;
+					continue;
+				}
+				std::vector<char> blob(static_cast<size_t>(asset.tellg()));
+				asset.seekg(0);
+				asset.read(blob.data(), blob.size());
+
+				LPAK_MESH mesh		= {};
+				mesh.nameOffset		= static_cast<uint32_t>(names.size());
+				mesh.nameLength		= static_cast<uint32_t>(name.size());
+				mesh.blobSize		= static_cast<uint32_t>(blob.size());
+				names += name;
+				meshes.push_back(mesh);
+				blobs.push_back(std::move(blob));
+				found = meshIndex.emplace(name, static_cast<uint32_t>(meshes.size() - 1)).first;
+			}
+			LPAK_INSTANCE instance = {};
+			memcpy(instance.world, _level.meshMatrices[i].data, sizeof(instance.world));
+			instance.mesh = found->second;
+			instances.push_back(instance);
+		}
+
+		std::vector<LPAK_LIGHT> lights;
+		for (auto& l : _level.lightMatrices)
+		{
+			LPAK_LIGHT light = {};
+			memcpy(light.position, &l.data[12], sizeof(light.position));
+			lights.push_back(light);
+		}
+
+		// Lay out the sections
+		uint64_t offset					= Align(sizeof(LPAK_HEADER));
+		LPAK_HEADER header				= {};
+		memcpy(header.magic, "LPAK", 4);
+		header.version					= LEVEL_PACK_VERSION;
+		header.instanceCount			= static_cast<uint32_t>(instances.size());
+		header.lightCount				= static_cast<uint32_t>(lights.size());
+		header.meshCount				= static_cast<uint32_t>(meshes.size());
+		header.instanceOffset			= static_cast<uint32_t>(offset);
+		offset							= Align(offset + instances.size() * sizeof(LPAK_INSTANCE));
+		header.lightOffset				= static_cast<uint32_t>(offset);
+		offset							= Align(offset + lights.size() * sizeof(LPAK_LIGHT));
+		header.meshOffset				= static_cast<uint32_t>(offset);
+		offset							= Align(offset + meshes.size() * sizeof(LPAK_MESH));
+		header.nameOffset				= static_cast<uint32_t>(offset);
+		header.nameSize					= static_cast<uint32_t>(names.size());
+		offset							= Align(offset + names.size());
+		for (auto& m : meshes)
+		{
+			m.blobOffset				= static_cast<uint32_t>(offset);
+			offset						= Align(offset + m.blobSize);
+		}
+		if (offset > UINT32_MAX)
+		{
+			std::cout << "LevelPack: Level is larger than 4GB!" << std::endl;
+			return false;
+		}
+		header.fileSize					= static_cast<uint32_t>(offset);
+
+		std::ofstream out{ _path, std::ios::out | std::ios::binary | std::ios::trunc };
+		if (!out.is_open())
+		{
+			std::cout << "LevelPack: Could not create file!\n" << "Path: " << _path << std::endl;
+			return false;
+		}
+		WriteAt(out, 0, &header, sizeof(header));
+		WriteAt(out, header.instanceOffset, instances.data(), instances.size() * sizeof(LPAK_INSTANCE));
+		WriteAt(out, header.lightOffset, lights.data(), lights.size() * sizeof(LPAK_LIGHT));
+		WriteAt(out, header.meshOffset, meshes.data(), meshes.size() * sizeof(LPAK_MESH));
+		WriteAt(out, header.nameOffset, names.data(), names.size());
+		for (size_t m = 0; m < meshes.size(); ++m)
+			WriteAt(out, meshes[m].blobOffset, blobs[m].data(), blobs[m].size());
+		WriteAt(out, header.fileSize, nullptr, 0);			// pads the last blob
+		return out.good();
+	}
+
+private:
+	static uint64_t Align(uint64_t _offset) { return (_offset + 15) & ~uint64_t(15); }
+
+	// Zero fills from the current position up to _offset, then writes
+	static void WriteAt(std::ofstream& _out, uint64_t _offset, const void* _data, size_t _size)
+	{
+		static const char zeros[16] = {};
+		while (static_cast<uint64_t>(_out.tellp()) < _offset)
+			_out.write(zeros, (std::min)(uint64_t(16), _offset - static_cast<uint64_t>(_out.tellp())));
+		if (_size)
+			_out.write(static_cast<const char*>(_data), _size);
+	}
+
+	// Every table and blob has to lie inside the mapping before anything dereferences it
+	bool Validate()
+	{
+		size_t size = m_file->Size();
+		if (size < sizeof(LPAK_HEADER))
+			return false;
+		const LPAK_HEADER* h = reinterpret_cast<const LPAK_HEADER*>(m_file->Data());
+		if (memcmp(h->magic, "LPAK", 4) != 0 || h->version != LEVEL_PACK_VERSION || h->fileSize != size)
+			return false;
+		if (!Inside(h->instanceOffset, uint64_t(h->instanceCount) * sizeof(LPAK_INSTANCE), size) ||
+			!Inside(h->lightOffset, uint64_t(h->lightCount) * sizeof(LPAK_LIGHT), size) ||
+			!Inside(h->meshOffset, uint64_t(h->meshCount) * sizeof(LPAK_MESH), size) ||
+			!Inside(h->nameOffset, h->nameSize, size))
+			return false;
+
+		const LPAK_MESH* meshes = reinterpret_cast<const LPAK_MESH*>(m_file->Data() + h->meshOffset);
+		for (uint32_t m = 0; m < h->meshCount; ++m)
+		{
+			if (!Inside(meshes[m].blobOffset, meshes[m].blobSize, size) ||
+				uint64_t(meshes[m].nameOffset) + meshes[m].nameLength > h->nameSize)
+				return false;
+		}
+		const LPAK_INSTANCE* instances = reinterpret_cast<const LPAK_INSTANCE*>(m_file->Data() + h->instanceOffset);
+		for (uint32_t i = 0; i < h->instanceCount; ++i)
+		{
+			if (instances[i].mesh >= h->meshCount)
+				return false;
+		}
+		m_header = h;
+		return true;
+	}
+
+	static bool Inside(uint64_t _offset, uint64_t _size, uint64_t _fileSize)
+	{
+		return (_offset & 15) == 0 && _offset + _size <= _fileSize;
+	}
+};
@@ -0,0 +1,77 @@
+// Converts a Blender exported GameLevel.txt (and the .h2b files it references) into a .lvlpak
+// Usage: LevelPacker <level.txt> <level.lvlpak> [asset directory, defaults to ../Assets/]
+//        LevelPacker --bench [entries]	(text parser throughput, new vs legacy, on a generated level)
+#include <chrono>
+#include <cstdio>
+#include "levelPack.h"
+
+static int Benchmark(size_t _entries)
+{
+	const char* path = "LevelPackerBench.txt";
+	if (!GenerateLevel(path, _entries))
+	{
+		std::cout << "LevelPacker: Could not write " << path << std::endl;
+		return 1;
+	}
+	std::ifstream sizeCheck{ path, std::ios::in | std::ios::binary | std::ios::ate };
+	double megabytes = static_cast<double>(sizeCheck.tellg()) / (1024.0 * 1024.0);
+	sizeCheck.close();
+
+	// Best of a few runs each, so the file is in the page cache for both
+	auto time = [&](bool (*_parse)(const std::string&, LEVEL_DATA&), LEVEL_DATA& _out) {
+		double best = 1e30;
+		for (int run = 0; run < 3; ++run)
+		{
+			_out.Clear();
+			auto start = std::chrono::steady_clock::now();
+			if (!_parse(path, _out))
+				return -1.0;
+			best = (std::min)(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	};
+	LEVEL_DATA legacy, current;
+	double legacySeconds	= time(ParseLevelTextLegacy, legacy);
+	double currentSeconds	= time(ParseLevelText, current);
+	remove(path);
+	if (legacySeconds < 0.0 || currentSeconds < 0.0)
+		return 1;
+
+	// Both have to agree (the legacy parser's atof and from_chars round the same way)
+	bool same = legacy.meshNames == current.meshNames && legacy.meshMatrices.size() == current.meshMatrices.size() &&
+		legacy.lightMatrices.size() == current.lightMatrices.size() &&
+		memcmp(legacy.meshMatrices.data(), current.meshMatrices.data(), legacy.meshMatrices.size() * sizeof(LEVEL_MATRIX)) == 0 &&
+		memcmp(legacy.lightMatrices.data(), current.lightMatrices.data(), legacy.lightMatrices.size() * sizeof(LEVEL_MATRIX)) == 0;
+
+	printf("%zu entries, %.1f MB\n", _entries, megabytes);
+	printf("legacy  %8.1f ms  %7.1f MB/s\n", legacySeconds * 1000.0, megabytes / legacySeconds);
+	printf("single  %8.1f ms  %7.1f MB/s  (%.1fx)\n", currentSeconds * 1000.0, megabytes / currentSeconds, legacySeconds / currentSeconds);
+	printf("results %s\n", same ? "match" : "DIFFER");
+	return same ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		return Benchmark(argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000);
+
+	if (argc < 3)
+	{
+		std::cout << "Usage: LevelPacker <level.txt> <level.lvlpak> [asset directory]\n"
+			<< "       LevelPacker --bench [entries]" << std::endl;
+		return 1;
+	}
+	std::string assetDir = argc > 3 ? argv[3] : "../Assets/";
+	if (assetDir.back() != '/' && assetDir.back() != '\\')
+		assetDir += '/';
+
+	LEVEL_DATA level;
+	if (!ParseLevelText(argv[1], level))
+		return 1;
+	if (!LevelPack::Write(argv[2], level, assetDir))
+		return 1;
+
+	std::cout << "LevelPacker: " << argv[1] << " -> " << argv[2] << " (" << level.meshMatrices.size() << " placements, "
+		<< level.lightMatrices.size() << " lights)" << std::endl;
+	return 0;
+}
@@ -0,0 +1,344 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <charconv>
+#include "mappedFile.h"
+
+// Mesh placements and point lights of one level, as plain floats so the converter needs no Gateware
+struct LEVEL_MATRIX
+{
+	float						data[16];							// row major, row vectors (same layout as GMATRIXF)
+};
+
+struct LEVEL_DATA
+{
+	std::vector<std::string>	meshNames;							// one per placement, without the ".000" suffix
+	std::vector<LEVEL_MATRIX>	meshMatrices;						// world matrix of each placement
+	std::vector<LEVEL_MATRIX>	lightMatrices;						// world matrix of each point light (position is row 4)
+
+	void Clear()
+	{
+		meshNames.clear();
+		meshMatrices.clear();
+		lightMatrices.clear();
+	}
+};
+
+// Where the text stopped making sense (1 based)
+struct LEVEL_PARSE_ERROR
+{
+	unsigned					line				= 0;
+	unsigned					column				= 0;
+	std::string					message;
+};
+
+// Single pass over a GameLevel.txt exported from Blender, straight from memory:
+//	MESH|LIGHT
+//	<name>[.<suffix>]
+//	<Matrix 4x4 (f, f, f, f)
+//	            (f, f, f, f) x4 >
+// Numbers go through std::from_chars into the output vectors, nothing is allocated per line
+// (mesh names are short enough for the small string buffer).
+class LevelTextParser
+{
+	const char*					m_cursor			= nullptr;
+	const char*					m_end				= nullptr;
+	const char*					m_lineStart			= nullptr;
+	unsigned					m_line				= 1;
+	LEVEL_PARSE_ERROR*			m_error				= nullptr;
+
+public:
+	bool Parse(const char* _text, size_t _size, LEVEL_DATA& _data, LEVEL_PARSE_ERROR& _error)
+	{
+		m_cursor		= _text;
+		m_end			= _text + _size;
+		m_lineStart		= _text;
+		m_line			= 1;
+		m_error			= &_error;
+		_error			= {};
+
+		// Exported entries are ~250 bytes, reserving up front avoids regrowing on big levels
+		_data.Clear();
+		_data.meshNames.reserve(_size / 256);
+		_data.meshMatrices.reserve(_size / 256);
+
+		while (true)
+		{
+			SkipSpace(true);
+			if (m_cursor == m_end)
+				return true;
+			if (*m_cursor == '#')								// exporter header / comments
+			{
+				SkipLine();
+				continue;
+			}
+
+			bool mesh	= Keyword("MESH");
+			bool light	= !mesh && Keyword("LIGHT");
+			if (!mesh && !light)
+				return Fail("expected MESH or LIGHT");
+			if (!EndOfLine())
+				return Fail("unexpected text after block keyword");
+
+			// Name line, the exporter's ".000" suffix is dropped
+			SkipSpace(false);
+			const char* name = m_cursor;
+			while (m_cursor < m_end && *m_cursor != '.' && *m_cursor != '\n' && *m_cursor != '\r')
+				++m_cursor;
+			size_t nameLength = m_cursor - name;
+			while (nameLength && (name[nameLength - 1] == ' ' || name[nameLength - 1] == '\t'))
+				--nameLength;
+			if (nameLength == 0)
+				return Fail("expected a name");
+			SkipLine();
+
+			LEVEL_MATRIX matrix;
+			if (!Matrix(matrix))
+				return false;
+			if (mesh)
+			{
+				_data.meshNames.emplace_back(name, nameLength);
+				_data.meshMatrices.push_back(matrix);
+			}
+			else
+				_data.lightMatrices.push_back(matrix);
+		}
+	}
+
+private:
+	bool Matrix(LEVEL_MATRIX& _matrix)
+	{
+		SkipSpace(false);
+		if (!Expect('<') || (SkipSpace(false), !Keyword("Matrix")) || (SkipSpace(false), !Keyword("4x4")))
+			return Fail("expected '<Matrix 4x4'");
+
+		for (int row = 0; row < 4; ++row)
+		{
+			SkipSpace(true);
+			if (!Expect('('))
+				return Fail("expected '(' to start matrix row");
+			for (int col = 0; col < 4; ++col)
+			{
+				SkipSpace(false);
+				if (col > 0)
+				{
+					if (!Expect(','))
+						return Fail("expected ',' between matrix values");
+					SkipSpace(false);
+				}
+				auto result = std::from_chars(m_cursor, m_end, _matrix.data[row * 4 + col]);
+				if (result.ec != std::errc())
+					return Fail("expected a number");
+				m_cursor = result.ptr;
+			}
+			SkipSpace(false);
+			if (!Expect(')'))
+				return Fail("expected ')' to end matrix row");
+		}
+		SkipSpace(false);
+		if (!Expect('>'))
+			return Fail("expected '>' to end matrix");
+		if (!EndOfLine())
+			return Fail("unexpected text after matrix");
+		return true;
+	}
+
+	// Spaces and tabs, plus line breaks when _newlines is set
+	void SkipSpace(bool _newlines)
+	{
+		while (m_cursor < m_end)
+		{
+			char c = *m_cursor;
+			if (c == '\n' && _newlines)
+			{
+				++m_cursor;
+				NewLine();
+			}
+			else if (c == ' ' || c == '\t' || (c == '\r' && _newlines))
+				++m_cursor;
+			else
+				break;
+		}
+	}
+
+	void SkipLine()
+	{
+		while (m_cursor < m_end && *m_cursor != '\n')
+			++m_cursor;
+		if (m_cursor < m_end)
+		{
+			++m_cursor;
+			NewLine();
+		}
+	}
+
+	// Only trailing whitespace left on this line (moves to the next one)
+	bool EndOfLine()
+	{
+		SkipSpace(false);
+		if (m_cursor < m_end && *m_cursor == '\r')
+			++m_cursor;
+		if (m_cursor == m_end)
+			return true;
+		if (*m_cursor != '\n')
+			return false;
+		++m_cursor;
+		NewLine();
+		return true;
+	}
+
+	void NewLine()
+	{
+		++m_line;
+		m_lineStart = m_cursor;
+	}
+
+	bool Expect(char _c)
+	{
+		if (m_cursor == m_end || *m_cursor != _c)
+			return false;
+		++m_cursor;
+		return true;
+	}
+
+	// A whole word (not the prefix of a longer one)
+	bool Keyword(const char* _word)
+	{
+		size_t length = strlen(_word);
+		if (size_t(m_end - m_cursor) < length || memcmp(m_cursor, _word, length) != 0)
+			return false;
+		const char* after = m_cursor + length;
+		if (after < m_end && (isalnum(static_cast<unsigned char>(*after)) || *after == '_'))
+			return false;
+		m_cursor = after;
+		return true;
+	}
+
+	bool Fail(const char* _message)
+	{
+		m_error->line		= m_line;
+		m_error->column		= static_cast<unsigned>(m_cursor - m_lineStart) + 1;
+		m_error->message	= _message;
+		return false;
+	}
+};
+
+// Maps a GameLevel.txt and parses it in place, reporting "path(line:column): problem" on malformed input
+inline bool ParseLevelText(const std::string& _filePath, LEVEL_DATA& _data)
+{
+	MappedFile file;
+	if (!file.Open(_filePath.c_str()))
+	{
+		std::cout << "ParseLevelText: Could not open file!\n" << "Path: " << _filePath << std::endl;
+		return false;
+	}
+
+	LEVEL_PARSE_ERROR error;
+	LevelTextParser parser;
+	if (!parser.Parse(reinterpret_cast<const char*>(file.Data()), file.Size(), _data, error))
+	{
+		std::cout << "ParseLevelText: " << _filePath << "(" << error.line << ":" << error.column << "): " << error.message << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Writes a level in the exporter's format with _entries meshes (and one light per 100 meshes)
+inline bool GenerateLevel(const char* _path, size_t _entries)
+{
+	FILE* file = fopen(_path, "wb");
+	if (file == nullptr)
+		return false;
+	fputs("# Game Level Exporter v1.0\n", file);
+	unsigned seed = 12345;
+	auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return ((seed >> 8) % 200000) / 1000.0f - 100.0f; };
+	for (size_t i = 0; i < _entries; ++i)
+	{
+		bool light = i % 100 == 99;
+		fprintf(file, "%s\n%s.%03u\n", light ? "LIGHT" : "MESH", light ? "Light" : "Wall", unsigned(i % 1000));
+		fprintf(file, "<Matrix 4x4 (%.4f, %.4f, %.4f, %.4f)\n", next(), next(), next(), 0.0f);
+		fprintf(file, "            (%.4f, %.4f, %.4f, %.4f)\n", next(), next(), next(), 0.0f);
+		fprintf(file, "            (%.4f, %.4f, %.4f, %.4f)\n", next(), next(), next(), 0.0f);
+		fprintf(file, "            (%.4f, %.4f, %.4f, %.4f)>\n", next(), next(), next(), 1.0f);
+	}
+	return fclose(file) == 0;
+}
+
+// The original two pass getline/strtok/atof parser, kept as the baseline for LevelPacker --bench
+inline bool ParseLevelTextLegacy(const std::string& _filePath, LEVEL_DATA& _data)
+{
+	std::string line				= " ";
+	std::string ignore[2]			= { "<Matrix" , "4x4" };
+	LEVEL_MATRIX tempMatrix			= {};
+	int ndx							= 0;
+
+	std::ifstream file{ _filePath, std::ios::in };		// Open file
+
+	if (!file.is_open())
+	{
+		std::cout << "ParseLevelTextLegacy: Could not open file!\n" << "Path: " << _filePath << std::endl;
+		return false;
+	}
+
+	// GET NAMES
+	while (!file.eof())
+	{
+		std::getline(file, line);
+		if (line == "MESH")							// If we find the mesh
+		{
+			std::getline(file, line, '.');			// Get the next line to retrieve the mesh name
+			_data.meshNames.push_back(line);
+			std::getline(file, line);
+		}
+	}
+	file.clear();
+	file.seekg(0);
+	// GET MATRIX DATA
+	while (!file.eof())									// enter an infinite loop (exit if nothing to read)
+	{
+		std::getline(file, line);						// read current line of text up to the new line
+		if (line == "MESH" || line == "LIGHT")			// check if you found a mesh or a light
+		{
+			std::vector<LEVEL_MATRIX>& target = line == "MESH" ? _data.meshMatrices : _data.lightMatrices;
+			std::getline(file, line);					// Skip name line to get to the matrix
+			for (int i = 0; i < 4; ++i)					// loop through each row
+			{
+				char temp[250];
+				char* getfloat;
+
+				std::getline(file, line);				// Get the 'i'th row of the matrix
+				strcpy(temp, line.c_str());				// convert line to char*
+				getfloat = strtok(temp, " (,)");		// Get first token in the row
+
+				while (getfloat != NULL)				// walk through the rest of the tokens in the row
+				{
+					if (getfloat != ignore[0] && getfloat != ignore[1])
+					{
+						float stof = atof(getfloat);
+						tempMatrix.data[ndx] = stof;
+						ndx++; // only increment ndx if we put something in it
+					}
+					getfloat = strtok(NULL, " (,)>");	// Get next token
+
+					// Once the last element is filled, push into vector and reset
+					if (ndx == 16)
+					{
+						target.push_back(tempMatrix);
+						tempMatrix = {};
+						ndx = 0;
+					}
+				} // Walk through Token
+			} // For every row in the Matrix
+		} // if "MESH" or "LIGHT"
+	} // !eof
+
+	// All done!
+	file.close();
+	return true;
+}
@@ -0,0 +1,192 @@
+// CPU microbenchmarks of the loaders, the scene setup and the camera math (no GPU or window needed)
+// Usage: LevelRenderer_bench [results.json, defaults to stdout] [asset directory, defaults to ../Assets/]
+// Every result is the time of one operation in milliseconds, so runs of two builds can be diffed by name.
+#define GATEWARE_ENABLE_CORE				// All libraries need this
+#define GATEWARE_ENABLE_MATH				// Enables Gateware math libraries
+#include "../Gateware/Gateware.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include "h2bParser.h"
+#include "levelRequest.h"
+#include "sceneData.h"
+
+struct BENCH_RESULT
+{
+	std::string		name;
+	uint32_t		samples		= 0;
+	uint32_t		batch		= 0;							// operations per sample
+	double			mean		= 0, min = 0, p50 = 0, max = 0;	// milliseconds per operation
+	uint64_t		items		= 0;							// what one operation produced (vertices, placements...)
+};
+
+// Keeps the optimizer from dropping work whose result is otherwise unused
+static volatile uint64_t g_sink = 0;
+
+// Times _samples runs of _batch calls to _body (after one untimed call to warm the caches)
+template <typename FUNC>
+static BENCH_RESULT Measure(const std::string& _name, uint32_t _samples, uint32_t _batch, FUNC&& _body)
+{
+	BENCH_RESULT result;
+	result.name			= _name;
+	result.samples		= _samples;
+	result.batch		= _batch;
+	result.items		= _body();
+
+	std::vector<double> times(_samples);
+	for (auto& t : times)
+	{
+		auto start		= std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < _batch; ++i)
+			g_sink		+= _body();
+		t				= std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / _batch;
+	}
+	std::sort(times.begin(), times.end());
+	for (double t : times)
+		result.mean		+= t / _samples;
+	result.min			= times.front();
+	result.p50			= times[(times.size() - 1) / 2];
+	result.max			= times.back();
+	return result;
+}
+
+static std::string JsonString(const std::string& _text)
+{
+	std::string out = "\"";
+	for (char c : _text)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			out += c;
+	}
+	return out + "\"";
+}
+
+static void WriteJson(std::ostream& _out, const std::vector<BENCH_RESULT>& _results)
+{
+	_out.precision(9);
+	_out << "{\n\t\"build\": { \"compiler\": " << JsonString(
+#if defined(_MSC_VER)
+		"msvc " + std::to_string(_MSC_VER)
+#elif defined(__clang__)
+		"clang " __clang_version__
+#elif defined(__GNUC__)
+		"gcc " __VERSION__
+#else
+		"unknown"
+#endif
+		) << ", \"debug\": " <<
+#ifdef NDEBUG
+		"false"
+#else
+		"true"
+#endif
+		<< " },\n\t\"benchmarks\": [\n";
+	for (size_t i = 0; i < _results.size(); ++i)
+	{
+		const BENCH_RESULT& r = _results[i];
+		_out << "\t\t{ \"name\": " << JsonString(r.name) << ", \"samples\": " << r.samples << ", \"batch\": " << r.batch
+			<< ", \"mean_ms\": " << r.mean << ", \"min_ms\": " << r.min << ", \"p50_ms\": " << r.p50 << ", \"max_ms\": " << r.max
+			<< ", \"items\": " << r.items << " }" << (i + 1 < _results.size() ? "," : "") << "\n";
+	}
+	_out << "\t]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::string outPath		= argc > 1 ? argv[1] : "";
+	std::string assetDir	= argc > 2 ? argv[2] : "../Assets/";
+	std::vector<BENCH_RESULT> results;
+
+	// H2B::Parser::Parse on every asset, in name order so runs line up
+	std::vector<std::filesystem::path> assets;
+	std::error_code error;
+	for (auto& entry : std::filesystem::directory_iterator(assetDir, error))
+		if (entry.path().extension() == ".h2b")
+			assets.push_back(entry.path());
+	std::sort(assets.begin(), assets.end());
+	if (assets.empty())
+		std::cerr << "LevelRenderer_bench: No .h2b files in \"" << assetDir << "\"" << std::endl;
+	H2B::Parser parser;
+	for (auto& asset : assets)
+	{
+		std::string path = asset.string();
+		results.push_back(Measure("h2b_parse/" + asset.stem().string(), 20, 1, [&]() -> uint64_t {
+			return parser.Parse(path.c_str()) ? parser.vertexCount : 0; }));
+	}
+
+	// ParseH2B on the shipped levels and on generated ones far bigger than them
+	auto parseLevel = [&](const std::string& _name, const std::string& _path, uint32_t _samples)
+	{
+		results.push_back(Measure("parse_level/" + _name, _samples, 1, [&]() -> uint64_t {
+			LEVEL_REQUEST request;
+			return ParseH2B(request, _path) ? request.placementMatrices.size() : 0; }));
+	};
+	parseLevel("GameLevel", "../GameLevel.txt", 50);
+	parseLevel("GameLevel2", "../GameLevel2.txt", 50);
+	for (size_t entries : { 10000, 100000 })
+	{
+		std::string path = "LevelRendererBench" + std::to_string(entries) + ".txt";
+		if (!GenerateLevel(path.c_str(), entries))
+		{
+			std::cerr << "LevelRenderer_bench: Could not write " << path << std::endl;
+			continue;
+		}
+		parseLevel("synthetic_" + std::to_string(entries), path, entries > 10000 ? 5 : 20);
+		remove(path.c_str());
+	}
+
+	// Scene data setup (InitSceneData) and the point light fill for the first level (SetLevelLights)
+	GW::MATH::GMatrix matrixMath;
+	GW::MATH::GVector vectorMath;
+	matrixMath.Create();
+	vectorMath.Create();
+	float fov = DegreesToRadians(65), aspectRatio = 16.0f / 9.0f;
+	GW::MATH::GMATRIXF view, projection;
+	SHADER_SCENE_DATA scene = {};
+	results.push_back(Measure("scene_data/init", 50, 10000, [&]() -> uint64_t {
+		scene = MakeSceneData(matrixMath, vectorMath, fov, aspectRatio, view, projection);
+		return static_cast<uint64_t>(scene.camPos.x != 0.0f); }));
+
+	LEVEL_REQUEST level;
+	ParseH2B(level, "../GameLevel.txt");
+	GW::MATH::GVECTORF pointColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+	results.push_back(Measure("scene_data/lights", 50, 10000, [&]() -> uint64_t {
+		SetSceneLights(scene, level.lights, pointColor);
+		return scene.lightCount; }));
+
+	// One frame of UpdateCamera's matrix work with every input held (the worst case)
+	CAMERA_INPUT input;
+	input.vertical		= 1.0f;
+	input.forward		= 1.0f;
+	input.strafe		= -0.5f;
+	input.mouseMoved	= true;
+	input.mouseX		= 3.0f;
+	input.mouseY		= -2.0f;
+	input.stickX		= 0.25f;
+	input.stickY		= 0.1f;
+	scene = MakeSceneData(matrixMath, vectorMath, fov, aspectRatio, view, projection);
+	results.push_back(Measure("camera/move", 50, 10000, [&]() -> uint64_t {
+		MoveCamera(matrixMath, view, input, 1.0f / 60.0f, fov, aspectRatio, 1280, 720);
+		return static_cast<uint64_t>(view.row4.x != 0.0f); }));
+
+	if (outPath.empty())
+	{
+		WriteJson(std::cout, results);
+		return 0;
+	}
+	std::ofstream file(outPath, std::ios_base::out | std::ios_base::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "LevelRenderer_bench: Could not write \"" << outPath << "\"" << std::endl;
+		return 1;
+	}
+	WriteJson(file, results);
+	std::cerr << "LevelRenderer_bench: " << results.size() << " results written to " << outPath << std::endl;
+	return 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "levelPack.h"
+
+// Where one asset comes from: its own .h2b file, or a blob inside a mapped level pack
+struct MESH_SOURCE
+{
+	std::string							path;						// also the cache key
+	std::shared_ptr<const MappedFile>	mapping;					// null for a standalone .h2b
+	size_t								offset		= 0;
+	size_t								size		= 0;
+};
+
+// What a level file asks for, before any mesh is loaded (Gateware math only, no GPU)
+struct LEVEL_REQUEST
+{
+	std::vector<MESH_SOURCE> meshes;				// each unique asset once
+	std::vector<std::string> meshNames;				// parallel to meshes
+	std::vector<uint32_t> placementMesh;			// per placement, index into meshes
+	std::vector<GW::MATH::GMATRIXF> placementMatrices;
+	std::vector<GW::MATH::GVECTORF> lights;
+};
+
+// Fallback when there is no level pack: parse the exported text, each mesh is its own .h2b
+inline bool ParseH2B(LEVEL_REQUEST& _request, const std::string& _filePath)
+{
+	LEVEL_DATA level;
+	if (!ParseLevelText(_filePath, level))
+		return false;
+
+	std::unordered_map<std::string, uint32_t> unique;
+	for (size_t i = 0; i < level.meshMatrices.size(); ++i)
+	{
+		// Only the first placement of an asset loads it, the rest share it
+		auto found = unique.find(level.meshNames[i]);
+		if (found == unique.end())
+		{
+			MESH_SOURCE source;
+			source.path = "../Assets/" + level.meshNames[i] + ".h2b";
+			_request.meshes.push_back(source);
+			_request.meshNames.push_back(level.meshNames[i]);
+			found = unique.emplace(level.meshNames[i], static_cast<uint32_t>(_request.meshes.size() - 1)).first;
+		}
+		_request.placementMesh.push_back(found->second);
+		_request.placementMatrices.push_back(*reinterpret_cast<const GW::MATH::GMATRIXF*>(level.meshMatrices[i].data));
+	}
+	for (auto& l : level.lightMatrices)
+		_request.lights.push_back(reinterpret_cast<const GW::MATH::GMATRIXF*>(l.data)->row4);
+	return true;
+}
+
+// Everything in one mapped file: the tables are read in place and each mesh is a view of its blob.
+// Returns false if there is no valid pack, so the caller can fall back to the text level.
+inline bool LoadLevelPack(LEVEL_REQUEST& _request, const std::string& _packPath)
+{
+	LevelPack pack;
+	if (!pack.Open(_packPath))
+		return false;
+
+	for (uint32_t m = 0; m < pack.MeshCount(); ++m)
+	{
+		MESH_SOURCE source;
+		_request.meshNames.push_back(pack.MeshName(m));
+		source.path		= "../Assets/" + _request.meshNames.back() + ".h2b";		// same key as the text path
+		source.mapping	= pack.Mapping();
+		source.offset	= pack.MeshBlobOffset(m);
+		source.size		= pack.MeshBlobSize(m);
+		_request.meshes.push_back(source);
+	}
+
+	const LPAK_INSTANCE* instances = pack.Instances();
+	for (uint32_t i = 0; i < pack.InstanceCount(); ++i)
+	{
+		_request.placementMesh.push_back(instances[i].mesh);
+		_request.placementMatrices.push_back(*reinterpret_cast<const GW::MATH::GMATRIXF*>(instances[i].world));
+	}
+
+	const LPAK_LIGHT* lights = pack.Lights();
+	for (uint32_t l = 0; l < pack.LightCount(); ++l)
+		_request.lights.push_back(*reinterpret_cast<const GW::MATH::GVECTORF*>(lights[l].position));
+	return true;
+}
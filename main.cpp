@@ -14,6 +14,7 @@
 // With what we want & what we don't defined we can include the API
 #include "../Gateware/Gateware.h"
 #include "renderer.h"
+#include "headlessBenchmark.h"
 
 // Open some namespaces to compact the code a bit
 using namespace GW;
@@ -22,8 +23,34 @@ using namespace SYSTEM;
 using namespace GRAPHICS;
 
 // Pop a window and use Vulkan to clear to a black screen
-int main()
+// (or, with --headless, render a level offscreen for a fixed number of frames and write timings to CSV)
+int main(int argc, char** argv)
 {
+	// --headless [level.txt] [frames] [out.csv] [camera path] [width] [height] [frames in flight] [parallel recording 0/1]
+	if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+	{
+		HEADLESS_OPTIONS options;
+		if (argc > 2) options.level			= argv[2];
+		if (argc > 3) options.frames		= static_cast<unsigned int>(atoi(argv[3]));
+		if (argc > 4) options.csv			= argv[4];
+		if (argc > 5) options.cameraPath	= argv[5];
+		if (argc > 6) options.width			= static_cast<unsigned int>(atoi(argv[6]));
+		if (argc > 7) options.height		= static_cast<unsigned int>(atoi(argv[7]));
+		if (argc > 8) options.framesInFlight = static_cast<unsigned int>(atoi(argv[8]));
+		if (argc > 9) options.parallelRecording = atoi(argv[9]) != 0;
+		if (options.frames == 0 || options.width == 0 || options.height == 0 || options.framesInFlight == 0)
+		{
+			std::cout << "Usage: --headless [level.txt] [frames] [out.csv] [camera path] [width] [height] [frames in flight] [parallel recording 0/1]" << std::endl;
+			return 1;
+		}
+		return RunHeadlessBenchmark(options);
+	}
+
+	// --frames-in-flight N
+	unsigned int framesInFlight = Renderer::DEFAULT_FRAMES_IN_FLIGHT;
+	if (argc > 2 && strcmp(argv[1], "--frames-in-flight") == 0 && atoi(argv[2]) > 0)
+		framesInFlight = static_cast<unsigned int>(atoi(argv[2]));
+
 	GWindow win;
 	GEventResponder msgs;
 	GVulkanSurface vulkan;
@@ -52,14 +79,19 @@ int main()
 			//"VK_LAYER_LUNARG_standard_validation",	// add if not on MacOS
 			//"VK_LAYER_RENDERDOC_Capture"				// add this if you have installed RenderDoc
 		};
-		if (+vulkan.Create(	win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT, 
-							sizeof(debugLayers)/sizeof(debugLayers[0]),
-							debugLayers, 0, nullptr, 0, nullptr, false))
+		unsigned int layerCount = sizeof(debugLayers)/sizeof(debugLayers[0]);
 #else
-		if (+vulkan.Create(win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT))
+		const char** debugLayers = nullptr;
+		unsigned int layerCount = 0;
 #endif
+		// Optional: lets GPU culling pick the draw count (retry without it on devices that lack it)
+		const char* deviceExtensions[] = { VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME };
+		bool drawIndirectCount = +vulkan.Create(win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT, layerCount, debugLayers, 0, nullptr, 1, deviceExtensions, true);
+		if (drawIndirectCount ||
+			+vulkan.Create(win, GW::GRAPHICS::DEPTH_BUFFER_SUPPORT, layerCount, debugLayers, 0, nullptr, 0, nullptr, true))
 		{
-			Renderer renderer(win, vulkan);		
+			Renderer renderer(win, vulkan, drawIndirectCount, framesInFlight);
+			renderer.SetClearValues(clrAndDepth);
 			while (+win.ProcessWindowEvents())
 			{
 				if (+vulkan.StartFrame(2, clrAndDepth))
@@ -69,7 +101,7 @@ int main()
 					vulkan.EndFrame(true);
 
 					// Change level
-					if (GetAsyncKeyState(VK_F1))
+					if (GetAsyncKeyState(VK_F1) & 1)
 						renderer.ChangeLevel();
 
 					// Pause music
@@ -80,6 +112,26 @@ int main()
 					if (GetAsyncKeyState(VK_F3))
 						renderer.ResumeMusic();
 
+					// Toggle indirect/direct drawing
+					if (GetAsyncKeyState(VK_F4) & 1)
+						renderer.ToggleIndirectDraws();
+
+					// Toggle frustum culling
+					if (GetAsyncKeyState(VK_F5) & 1)
+						renderer.ToggleCulling();
+
+					// Record GPU timings to CSV
+					if (GetAsyncKeyState(VK_F6) & 1)
+						renderer.ToggleGpuTimingCsv();
+
+					// Toggle multithreaded command recording
+					if (GetAsyncKeyState(VK_F7) & 1)
+						renderer.ToggleParallelRecording();
+
+					// Toggle reusing the recorded scene commands
+					if (GetAsyncKeyState(VK_F8) & 1)
+						renderer.ToggleStaticRecording();
+
 					// Exit level
 					if (GetAsyncKeyState(VK_ESCAPE))
 					{
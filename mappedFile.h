@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Read-only view of a whole file. The OS pages it in on first touch, nothing is copied.
+class MappedFile
+{
+	const uint8_t*			m_data			= nullptr;
+	size_t					m_size			= 0;
+#if defined(_WIN32)
+	HANDLE					m_file			= INVALID_HANDLE_VALUE;
+	HANDLE					m_mapping		= nullptr;
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { Close(); }
+
+	bool Open(const char* _path)
+	{
+		Close();
+#if defined(_WIN32)
+		m_file = CreateFileA(_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping == nullptr)
+		{
+			Close();
+			return false;
+		}
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		m_size = static_cast<size_t>(size.QuadPart);
+#else
+		int fd = open(_path, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+		void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);											// the mapping keeps the file alive
+		if (view == MAP_FAILED)
+			return false;
+		m_data = static_cast<const uint8_t*>(view);
+		m_size = static_cast<size_t>(info.st_size);
+#endif
+		if (m_data == nullptr)
+		{
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+#if defined(_WIN32)
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+		m_mapping	= nullptr;
+		m_file		= INVALID_HANDLE_VALUE;
+#else
+		if (m_data)
+			munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+		m_data		= nullptr;
+		m_size		= 0;
+	}
+
+	bool IsOpen() const { return m_data != nullptr; }
+	const uint8_t* Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+};
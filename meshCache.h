@@ -0,0 +1,210 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <iostream>
+#include "stagingBatch.h"
+#include "geometryArena.h"
+#include "h2bMappedAsset.h"
+#include "threadPool.h"
+#include "levelRequest.h"
+
+// Geometry shared by every placement of the same .h2b file
+struct MeshAsset
+{
+	H2B::MappedAsset			data;								// mapped once per unique asset, payloads read in place
+
+	// Where the mesh lives inside the GeometryArena
+	bool						resident			= false;
+	uint32_t					firstVertex			= 0;			// added to every index (vertexOffset)
+	uint32_t					firstIndex			= 0;			// added to each submesh's indexOffset
+};
+
+// Maps and uploads each .h2b once, no matter how many level entries place it
+class MeshCache
+{
+	std::unordered_map<std::string, std::shared_ptr<MeshAsset>> m_assets;	// keyed by asset path
+
+public:
+	// Maps and decodes (bounds) every source on the pool's workers, returns them in order (nullptr on failure).
+	// Touches no cache state, so it can run on any thread while the cache is in use.
+	static std::vector<std::shared_ptr<MeshAsset>> DecodeAll(const std::vector<MESH_SOURCE> &_sources, ThreadPool &_pool)
+	{
+		std::vector<std::future<std::shared_ptr<MeshAsset>>> pending;
+		for (auto &source : _sources)
+		{
+			const MESH_SOURCE* s = &source;
+			pending.push_back(_pool.Submit([s]() { return Decode(*s); }));
+		}
+		std::vector<std::shared_ptr<MeshAsset>> assets;
+		for (auto &p : pending)
+			assets.push_back(p.get());
+		return assets;
+	}
+
+	// Swaps each freshly decoded asset for the cached one with the same path (which may already be resident),
+	// caching the rest. Failed sources stay nullptr.
+	void Adopt(const std::vector<MESH_SOURCE> &_sources, std::vector<std::shared_ptr<MeshAsset>> &_assets)
+	{
+		for (size_t i = 0; i < _sources.size(); ++i)
+		{
+			auto found = m_assets.find(_sources[i].path);
+			if (found != m_assets.end())
+				_assets[i] = found->second;
+			else if (_assets[i] == nullptr)
+				std::cout << "MeshCache: Could not load mesh!\n" << "Path: " << _sources[i].path << std::endl;
+			else
+				m_assets.emplace(_sources[i].path, _assets[i]);
+		}
+	}
+
+	// Forget assets nothing references any more (e.g. after a level change) and free their arena space
+	void ReleaseUnused(GeometryArena &_arena)
+	{
+		for (auto a = m_assets.begin(); a != m_assets.end();)
+		{
+			if (a->second.use_count() > 1)
+			{
+				++a;
+				continue;
+			}
+			MeshAsset &mesh = *a->second;
+			if (mesh.resident)
+				_arena.Free(mesh.firstVertex, mesh.data.vertexCount, mesh.firstIndex, mesh.data.indexCount);
+			a = m_assets.erase(a);
+		}
+	}
+
+	// Place every asset that isn't resident yet into the arena, copying straight out of the mappings.
+	// If the free lists are too fragmented the arena is compacted (every asset repacked from the front),
+	// and if it is simply too small it is recreated bigger. The copies are queued on _staging for the caller
+	// to submit (or written directly when the arena is host-visible).
+	// With _canMove false (resident meshes are still being drawn) it only fills free space, and returns
+	// false without changing anything if that isn't enough (see UploadFresh).
+	bool Upload(GeometryArena &_arena, GpuAllocator &_allocator, StagingBatch &_staging, bool _canMove = true)
+	{
+		std::vector<MeshAsset*> pending;
+		uint32_t totalVertices = 0, totalIndices = 0;
+		for (auto &a : m_assets)
+		{
+			totalVertices	+= a.second->data.vertexCount;
+			totalIndices	+= a.second->data.indexCount;
+			if (!a.second->resident)
+				pending.push_back(a.second.get());
+		}
+
+		bool placed = false;
+		bool fits = _arena.IsCreated() && totalVertices <= _arena.VertexCapacity() && totalIndices <= _arena.IndexCapacity();
+		if (!_canMove && !(fits && TryAllocate(_arena, pending)))
+			return false;
+		if (!_canMove)
+			placed = true;
+		else if (!fits)
+		{
+			// Grow with some headroom so the next level change can usually reuse the holes
+			_arena.Create(_allocator, totalVertices + totalVertices / 4, totalIndices + totalIndices / 4);
+			pending = Evict();
+		}
+		else if (TryAllocate(_arena, pending))
+			placed = true;
+		else
+		{
+			// Enough space in total but not in one piece, compact
+			_arena.Reset();
+			pending = Evict();
+		}
+
+		if (!placed && !TryAllocate(_arena, pending))
+		{
+			std::cout << "MeshCache: Geometry arena allocation failed!" << std::endl;
+			return false;
+		}
+
+		Write(_arena, _staging, pending);
+		return true;
+	}
+
+	// For when Upload can't fill the free space: places _needed (the incoming level's meshes) in _fresh, created
+	// just big enough with some headroom, and leaves the arena the current level draws from untouched (its draws
+	// have the old offsets baked in). Every other asset stops being resident, their space goes with the old arena.
+	bool UploadFresh(GeometryArena &_fresh, GpuAllocator &_allocator, StagingBatch &_staging, const std::vector<MeshAsset*> &_needed)
+	{
+		uint32_t totalVertices = 0, totalIndices = 0;
+		for (auto m : _needed)
+		{
+			totalVertices	+= m->data.vertexCount;
+			totalIndices	+= m->data.indexCount;
+		}
+		_fresh.Create(_allocator, totalVertices + totalVertices / 4, totalIndices + totalIndices / 4);
+		Evict();
+
+		std::vector<MeshAsset*> pending = _needed;
+		if (!TryAllocate(_fresh, pending))
+		{
+			std::cout << "MeshCache: Geometry arena allocation failed!" << std::endl;
+			return false;
+		}
+		Write(_fresh, _staging, pending);
+		return true;
+	}
+
+	size_t Size() const { return m_assets.size(); }
+
+	// Forget every asset (their arena space goes with the arena)
+	void CleanUp()
+	{
+		m_assets.clear();
+	}
+
+private:
+	// Runs on a worker, touches nothing but the new asset
+	static std::shared_ptr<MeshAsset> Decode(const MESH_SOURCE &_source)
+	{
+		std::shared_ptr<MeshAsset> asset = std::make_shared<MeshAsset>();
+		bool loaded = _source.mapping ? asset->data.View(_source.mapping, _source.offset, _source.size)
+			: asset->data.Open(_source.path.c_str());
+		return loaded ? asset : nullptr;
+	}
+
+	static void Write(GeometryArena &_arena, StagingBatch &_staging, const std::vector<MeshAsset*> &_pending)
+	{
+		for (auto m : _pending)
+		{
+			_arena.Write(_staging, m->firstVertex, m->data.vertices.data(), m->data.vertexCount,
+				m->firstIndex, m->data.indices.data(), m->data.indexCount);
+		}
+	}
+
+	// Mark every asset as needing space again, returns all of them
+	std::vector<MeshAsset*> Evict()
+	{
+		std::vector<MeshAsset*> all;
+		for (auto &a : m_assets)
+		{
+			a.second->resident = false;
+			all.push_back(a.second.get());
+		}
+		return all;
+	}
+
+	// Allocate every pending asset, on failure undoes this pass and returns false
+	bool TryAllocate(GeometryArena &_arena, std::vector<MeshAsset*> &_pending)
+	{
+		for (int i = 0; i < _pending.size(); ++i)
+		{
+			MeshAsset &m = *_pending[i];
+			if (_arena.Allocate(m.data.vertexCount, m.data.indexCount, m.firstVertex, m.firstIndex))
+			{
+				m.resident = true;
+				continue;
+			}
+			for (int j = 0; j < i; ++j)
+			{
+				_arena.Free(_pending[j]->firstVertex, _pending[j]->data.vertexCount, _pending[j]->firstIndex, _pending[j]->data.indexCount);
+				_pending[j]->resident = false;
+			}
+			return false;
+		}
+		return true;
+	}
+};
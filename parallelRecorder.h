@@ -0,0 +1,121 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <future>
+#include <algorithm>
+#include "threadPool.h"
+
+// Records one range of work split into parts, each part on its own thread into its own secondary command buffer
+// (part 0 on the calling thread, the rest on a pool of recording threads). Every part has one command pool per
+// frame, so no two threads ever share a pool and a frame's pools are only reset once that frame comes around again.
+class ParallelRecorder
+{
+	VkDevice								m_device			= nullptr;
+	std::vector<std::vector<VkCommandPool>>	m_pools;							// per frame, per part
+	std::vector<std::vector<VkCommandBuffer>>	m_buffers;						// per frame, per part
+	ThreadPool								m_threads;							// separate from the asset decoders
+	uint32_t								m_parts				= 0;
+	uint32_t								m_total				= 0;
+	double									m_milliseconds		= 0.0;
+
+public:
+	// _threads = 0 records on every hardware thread (the calling one included)
+	void Create(VkDevice _device, uint32_t _queueFamily, uint32_t _frames, uint32_t _threads = 0)
+	{
+		m_device							= _device;
+		if (_threads != 1)
+			m_threads.Create(_threads ? _threads - 1 : 0);				// 0: one per hardware thread but this one
+		m_parts								= m_threads.Size() + 1;
+
+		VkCommandPoolCreateInfo poolInfo	= {};
+		poolInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags						= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;		// reset as a whole every frame
+		poolInfo.queueFamilyIndex			= _queueFamily;
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level						= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount		= 1;
+
+		m_pools.assign(_frames, std::vector<VkCommandPool>(m_parts, nullptr));
+		m_buffers.assign(_frames, std::vector<VkCommandBuffer>(m_parts, nullptr));
+		for (uint32_t f = 0; f < _frames; ++f)
+		{
+			for (uint32_t p = 0; p < m_parts; ++p)
+			{
+				vkCreateCommandPool(_device, &poolInfo, nullptr, &m_pools[f][p]);
+				allocInfo.commandPool		= m_pools[f][p];
+				vkAllocateCommandBuffers(_device, &allocInfo, &m_buffers[f][p]);
+			}
+		}
+	}
+
+	bool IsCreated() const { return !m_pools.empty(); }
+
+	// Most parts a range is split into
+	uint32_t Parts() const { return m_parts; }
+
+	// Splits [0, _count) into as many parts as there are threads (none smaller than _minPerPart) and records
+	// _record(commandBuffer, part, first, end) for each inside subpass 0 of _renderPass/_framebuffer.
+	// _record runs concurrently and may only touch the command buffer it gets. Blocks until every part is
+	// recorded, returns how many there are (Buffers(_frame) in the order to execute them).
+	template <typename F>
+	uint32_t Record(unsigned int _frame, VkRenderPass _renderPass, VkFramebuffer _framebuffer, uint32_t _count,
+		uint32_t _minPerPart, const F& _record)
+	{
+		auto start							= std::chrono::steady_clock::now();
+		uint32_t parts						= (std::max)(1u, (std::min)(m_parts, _count / (std::max)(_minPerPart, 1u)));
+
+		auto recordPart = [&, parts](uint32_t _part) -> uint32_t
+		{
+			vkResetCommandPool(m_device, m_pools[_frame][_part], 0);
+
+			VkCommandBufferInheritanceInfo inheritance = {};
+			inheritance.sType				= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritance.renderPass			= _renderPass;
+			inheritance.subpass				= 0;
+			inheritance.framebuffer			= _framebuffer;
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags					= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			beginInfo.pInheritanceInfo		= &inheritance;
+
+			VkCommandBuffer commandBuffer	= m_buffers[_frame][_part];
+			vkBeginCommandBuffer(commandBuffer, &beginInfo);
+			uint32_t first					= static_cast<uint32_t>(uint64_t(_count) * _part / parts);
+			uint32_t end					= static_cast<uint32_t>(uint64_t(_count) * (_part + 1) / parts);
+			uint32_t recorded				= _record(commandBuffer, _part, first, end);
+			vkEndCommandBuffer(commandBuffer);
+			return recorded;
+		};
+
+		std::vector<std::future<uint32_t>> pending;
+		for (uint32_t p = 1; p < parts; ++p)
+			pending.push_back(m_threads.Submit([&recordPart, p]() { return recordPart(p); }));
+		m_total								= recordPart(0);
+		for (auto& p : pending)
+			m_total							+= p.get();
+
+		m_milliseconds						= std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return parts;
+	}
+
+	const VkCommandBuffer* Buffers(unsigned int _frame) const { return m_buffers[_frame].data(); }
+
+	// Sum of what _record returned, and the wall time of the last Record
+	uint32_t Total() const { return m_total; }
+	double Milliseconds() const { return m_milliseconds; }
+
+	// The command buffers must not be in use any more
+	void CleanUp()
+	{
+		m_threads.CleanUp();
+		for (auto& frame : m_pools)
+			for (auto& p : frame)
+				vkDestroyCommandPool(m_device, p, nullptr);		// frees its command buffer
+		m_pools.clear();
+		m_buffers.clear();
+		m_parts								= 0;
+	}
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+// One VkPipelineCache for every pipeline the renderer creates, seeded from a file written by the
+// previous run. The driver's own header at the front of the blob is checked against this device first,
+// a blob from another GPU or driver is ignored rather than handed to vkCreatePipelineCache.
+class PipelineCache
+{
+	VkPipelineCache					m_cache				= VK_NULL_HANDLE;
+	std::string						m_path;
+	size_t							m_loadedBytes		= 0;		// 0 when the cache started empty (cold)
+
+public:
+	void Create(VkPhysicalDevice _physicalDevice, VkDevice _device, const char* _path)
+	{
+		m_path = _path;
+		m_loadedBytes = 0;
+
+		std::vector<uint8_t> blob = ReadFile(_path);
+		if (!blob.empty() && !Matches(_physicalDevice, blob))
+		{
+			std::cout << "PipelineCache: \"" << _path << "\" was made for another device or driver, starting empty" << std::endl;
+			blob.clear();
+		}
+
+		VkPipelineCacheCreateInfo create_info			= {};
+		create_info.sType								= VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		create_info.initialDataSize						= blob.size();
+		create_info.pInitialData						= blob.empty() ? nullptr : blob.data();
+		if (vkCreatePipelineCache(_device, &create_info, nullptr, &m_cache) != VK_SUCCESS && !blob.empty())
+		{
+			// Passed our checks but the driver still refused it
+			create_info.initialDataSize					= 0;
+			create_info.pInitialData					= nullptr;
+			vkCreatePipelineCache(_device, &create_info, nullptr, &m_cache);
+			blob.clear();
+		}
+		m_loadedBytes = blob.size();
+	}
+
+	VkPipelineCache Get() const { return m_cache; }
+	bool IsWarm() const { return m_loadedBytes != 0; }
+
+	// Writes the cache back, to a temporary file first and then renamed over the old one
+	void Save(VkDevice _device) const
+	{
+		if (m_cache == VK_NULL_HANDLE || m_path.empty())
+			return;
+		size_t size = 0;
+		if (vkGetPipelineCacheData(_device, m_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+			return;
+		std::vector<uint8_t> blob(size);
+		if (vkGetPipelineCacheData(_device, m_cache, &size, blob.data()) != VK_SUCCESS)
+			return;
+
+		std::string temp = m_path + ".tmp";
+		{
+			std::ofstream file(temp, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			file.write(reinterpret_cast<const char*>(blob.data()), size);
+			if (!file.good())
+			{
+				file.close();
+				std::error_code ignored;
+				std::filesystem::remove(temp, ignored);
+				std::cout << "PipelineCache: Could not write \"" << m_path << "\"" << std::endl;
+				return;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temp, m_path, error);
+		if (error)
+		{
+			std::filesystem::remove(temp, error);
+			std::cout << "PipelineCache: Could not write \"" << m_path << "\"" << std::endl;
+		}
+	}
+
+	void CleanUp(VkDevice _device)
+	{
+		if (m_cache != VK_NULL_HANDLE)
+			vkDestroyPipelineCache(_device, m_cache, nullptr);
+		m_cache = VK_NULL_HANDLE;
+	}
+
+private:
+	static std::vector<uint8_t> ReadFile(const char* _path)
+	{
+		std::vector<uint8_t> blob;
+		std::ifstream file(_path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+		if (!file.is_open())
+			return blob;
+		std::streamoff size = file.tellg();
+		if (size <= 0)
+			return blob;
+		blob.resize(size_t(size));
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(blob.data()), size))
+			blob.clear();
+		return blob;
+	}
+
+	// VkPipelineCacheHeaderVersionOne: header size, version, vendor, device, cache UUID
+	static bool Matches(VkPhysicalDevice _physicalDevice, const std::vector<uint8_t>& _blob)
+	{
+		VkPipelineCacheHeaderVersionOne header;
+		if (_blob.size() < sizeof(header))
+			return false;
+		memcpy(&header, _blob.data(), sizeof(header));
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+		return header.headerSize >= sizeof(header) && header.headerSize <= _blob.size() &&
+			header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+			memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+};
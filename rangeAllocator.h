@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// First-fit free list over [0, capacity) elements
+class RangeAllocator
+{
+	struct RANGE { uint32_t offset, size; };
+	std::vector<RANGE>	m_free;						// sorted by offset, never adjacent
+	uint32_t			m_capacity	= 0;
+	uint32_t			m_used		= 0;
+
+public:
+	static const uint32_t INVALID = 0xFFFFFFFF;
+
+	void Reset(uint32_t _capacity)
+	{
+		m_capacity	= _capacity;
+		m_used		= 0;
+		m_free.clear();
+		if (_capacity)
+			m_free.push_back({ 0, _capacity });
+	}
+
+	// Returns the offset of _size free elements, or INVALID if no single hole is big enough
+	uint32_t Allocate(uint32_t _size)
+	{
+		for (int i = 0; i < m_free.size(); ++i)
+		{
+			if (m_free[i].size < _size)
+				continue;
+			uint32_t offset		= m_free[i].offset;
+			m_free[i].offset	+= _size;
+			m_free[i].size		-= _size;
+			if (m_free[i].size == 0)
+				m_free.erase(m_free.begin() + i);
+			m_used += _size;
+			return offset;
+		}
+		return INVALID;
+	}
+
+	// Give a range back, merging it with its neighbours
+	void Free(uint32_t _offset, uint32_t _size)
+	{
+		if (_size == 0)
+			return;
+		int i = 0;
+		while (i < m_free.size() && m_free[i].offset < _offset)
+			++i;
+		m_free.insert(m_free.begin() + i, { _offset, _size });
+		m_used -= _size;
+
+		// merge with the next hole, then with the previous one
+		if (i + 1 < m_free.size() && m_free[i].offset + m_free[i].size == m_free[i + 1].offset)
+		{
+			m_free[i].size += m_free[i + 1].size;
+			m_free.erase(m_free.begin() + i + 1);
+		}
+		if (i > 0 && m_free[i - 1].offset + m_free[i - 1].size == m_free[i].offset)
+		{
+			m_free[i - 1].size += m_free[i].size;
+			m_free.erase(m_free.begin() + i);
+		}
+	}
+
+	uint32_t Capacity() const { return m_capacity; }
+	uint32_t Used() const { return m_used; }
+};
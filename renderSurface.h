@@ -0,0 +1,172 @@
+#pragma once
+
+// One color and one depth attachment in a single subpass, the layout of every surface's pass.
+// _continue makes the pass that picks up after the surface's pass was ended: compatible with it when given the same
+// formats, but color is loaded from _colorLayout instead of cleared. Depth is still cleared since the surface's pass
+// doesn't store it, so each attachment is only cleared once per frame.
+inline VkRenderPass CreateSurfacePass(VkDevice _device, VkFormat _colorFormat, VkFormat _depthFormat, VkImageLayout _colorLayout,
+	bool _continue)
+{
+	VkAttachmentDescription attachments[2] = {};
+	attachments[0].format				= _colorFormat;
+	attachments[0].samples				= VK_SAMPLE_COUNT_1_BIT;
+	attachments[0].loadOp				= _continue ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].storeOp				= VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[0].stencilLoadOp		= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[0].stencilStoreOp		= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout		= _continue ? _colorLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[0].finalLayout			= _colorLayout;
+	attachments[1]						= attachments[0];
+	attachments[1].format				= _depthFormat;
+	attachments[1].loadOp				= VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[1].storeOp				= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].initialLayout		= VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[1].finalLayout			= VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorRef		= { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkAttachmentReference depthRef		= { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription subpass		= {};
+	subpass.pipelineBindPoint			= VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount		= 1;
+	subpass.pColorAttachments			= &colorRef;
+	subpass.pDepthStencilAttachment		= &depthRef;
+
+	VkRenderPassCreateInfo passInfo		= {};
+	passInfo.sType						= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	passInfo.attachmentCount			= 2;
+	passInfo.pAttachments				= attachments;
+	passInfo.subpassCount				= 1;
+	passInfo.pSubpasses					= &subpass;
+	VkRenderPass renderPass				= nullptr;
+	if (vkCreateRenderPass(_device, &passInfo, nullptr, &renderPass) != VK_SUCCESS)
+		return nullptr;
+	return renderPass;
+}
+
+// What the Renderer draws into: the device, the queue it submits on, and one command buffer per frame
+// that is already inside a render pass when Render is called (StartFrame/EndFrame belong to the owner).
+// GatewareSurface wraps a window's GVulkanSurface, HeadlessSurface an offscreen target.
+class RenderSurface
+{
+public:
+	virtual ~RenderSurface() = default;
+
+	virtual VkDevice			Device() const = 0;
+	virtual VkPhysicalDevice	PhysicalDevice() const = 0;
+	virtual VkQueue				GraphicsQueue() const = 0;
+	virtual unsigned int		GraphicsFamily() const = 0;
+	virtual VkCommandPool		CommandPool() const = 0;				// for one-off transfer work
+	virtual VkRenderPass		RenderPass() const = 0;
+	virtual VkRenderPass		ContinuePass() const = 0;				// see CreateSurfacePass, nullptr: none known to be compatible
+	virtual VkFramebuffer		Framebuffer(unsigned int _frame) const = 0;
+	virtual unsigned int		FrameCount() const = 0;					// command buffers cycled through (swapchain images)
+	virtual unsigned int		CurrentFrame() const = 0;
+	virtual VkCommandBuffer		CommandBuffer(unsigned int _frame) const = 0;
+	virtual unsigned int		Width() const = 0;
+	virtual unsigned int		Height() const = 0;
+	virtual bool				DrawIndirectCount() const = 0;			// enabled at device creation (extension or 1.2 feature)
+	virtual float				AspectRatio() const { return Height() ? float(Width()) / float(Height()) : 1.0f; }
+};
+
+#ifdef GATEWARE_ENABLE_GRAPHICS
+// A window's swapchain, through Gateware
+class GatewareSurface : public RenderSurface
+{
+	// Proxy getters aren't const
+	mutable GW::SYSTEM::GWindow				m_win;
+	mutable GW::GRAPHICS::GVulkanSurface	m_vlk;
+	bool									m_drawIndirectCount	= false;
+
+public:
+	// _drawIndirectCount: _vlk was created with VK_KHR_draw_indirect_count (Gateware enables no 1.2 features)
+	void Create(GW::SYSTEM::GWindow _win, GW::GRAPHICS::GVulkanSurface _vlk, bool _drawIndirectCount)
+	{
+		m_win = _win;
+		m_vlk = _vlk;
+		m_drawIndirectCount = _drawIndirectCount;
+	}
+
+	VkDevice Device() const override
+	{
+		VkDevice device = nullptr;
+		m_vlk.GetDevice((void**)&device);
+		return device;
+	}
+	VkPhysicalDevice PhysicalDevice() const override
+	{
+		VkPhysicalDevice physicalDevice = nullptr;
+		m_vlk.GetPhysicalDevice((void**)&physicalDevice);
+		return physicalDevice;
+	}
+	VkQueue GraphicsQueue() const override
+	{
+		VkQueue queue = nullptr;
+		m_vlk.GetGraphicsQueue((void**)&queue);
+		return queue;
+	}
+	unsigned int GraphicsFamily() const override
+	{
+		unsigned int graphicsFamily = 0, presentFamily = 0;
+		m_vlk.GetQueueFamilyIndices(graphicsFamily, presentFamily);
+		return graphicsFamily;
+	}
+	VkCommandPool CommandPool() const override
+	{
+		VkCommandPool pool = nullptr;
+		m_vlk.GetCommandPool((void**)&pool);
+		return pool;
+	}
+	VkRenderPass RenderPass() const override
+	{
+		VkRenderPass renderPass = nullptr;
+		m_vlk.GetRenderPass((void**)&renderPass);
+		return renderPass;
+	}
+	// GVulkanSurface builds its pass internally and doesn't report the attachment formats it picked, so no pass can be
+	// made that is known to be compatible with it: secondaries aren't used on a window, everything is recorded inline
+	VkRenderPass ContinuePass() const override { return nullptr; }
+	VkFramebuffer Framebuffer(unsigned int _frame) const override
+	{
+		VkFramebuffer framebuffer = nullptr;
+		m_vlk.GetSwapchainFramebuffer(_frame, (void**)&framebuffer);
+		return framebuffer;
+	}
+	unsigned int FrameCount() const override
+	{
+		unsigned int count = 0;
+		m_vlk.GetSwapchainImageCount(count);
+		return count;
+	}
+	unsigned int CurrentFrame() const override
+	{
+		unsigned int current = 0;
+		m_vlk.GetSwapchainCurrentImage(current);
+		return current;
+	}
+	VkCommandBuffer CommandBuffer(unsigned int _frame) const override
+	{
+		VkCommandBuffer commandBuffer = nullptr;
+		m_vlk.GetCommandBuffer(_frame, (void**)&commandBuffer);
+		return commandBuffer;
+	}
+	unsigned int Width() const override
+	{
+		unsigned int width = 0;
+		m_win.GetClientWidth(width);
+		return width;
+	}
+	unsigned int Height() const override
+	{
+		unsigned int height = 0;
+		m_win.GetClientHeight(height);
+		return height;
+	}
+	bool DrawIndirectCount() const override { return m_drawIndirectCount; }
+	float AspectRatio() const override
+	{
+		float aspectRatio = 1.0f;
+		m_vlk.GetAspectRatio(aspectRatio);
+		return aspectRatio;
+	}
+};
+#endif
@@ -1,5 +1,17 @@
 // Include model class
 #include "model.h"
+#include "drawList.h"
+#include "frustumCuller.h"
+#include "levelPack.h"
+#include "threadPool.h"
+#include "shaderCache.h"
+#include "pipelineCache.h"
+#include "gpuTimer.h"
+#include "renderSurface.h"
+#include "parallelRecorder.h"
+#include "staticCommands.h"
+#include "frameContexts.h"
+#include <future>
 
 // Creation, Rendering & Cleanup
 class Renderer
@@ -7,16 +19,28 @@ class Renderer
 	// Collect the mesh names and their matrices
 	struct GameLevelData
 	{
-		std::vector<H2B::Parser> modelData;				// Every mesh in the level
+		std::vector<std::shared_ptr<MeshAsset>> modelData;	// Every mesh in the level (shared per unique asset)
 		std::vector<std::string> modelNames;			// Names of each model
 		std::vector<GW::MATH::GMATRIXF> modelMatrices;  // model world matrices
 		std::vector<GW::MATH::GVECTORF> pLightPos;		// point light positions in the scene
 	};
-	GameLevelData					m_levelData = {};
+
+	// Where the last level load spent its time (stages 1 and 2 run before the GPU work, 3+ on this thread)
+	struct LOAD_TIMINGS
+	{
+		double parse = 0, decode = 0, upload = 0, buffers = 0, shaders = 0, pipeline = 0;
+		uint32_t decodedAssets = 0;
+	};
+	LOAD_TIMINGS					m_loadTimings;
+
+	// Worker threads for asset decoding (a level change also parses on its own background thread)
+	ThreadPool						m_workers;
 
 	// proxy handles
 	GW::SYSTEM::GWindow				win;
 	GW::GRAPHICS::GVulkanSurface	vlk;
+	GatewareSurface					m_windowSurface;
+	RenderSurface*					m_surface			= nullptr;	// m_windowSurface, or an offscreen target
 	GW::CORE::GEventReceiver		shutdown;
 	GW::INPUT::GInput				m_inputProxy;
 	GW::INPUT::GController			m_controllerProxy;
@@ -30,20 +54,102 @@ class Renderer
 	VkDevice						m_device			= nullptr;
 	VkPipeline						m_pipeline			= nullptr;
 	VkPipelineLayout				m_pipelineLayout	= nullptr;
+	SceneDescriptors				m_sceneDescriptors;					// layout and pool every level's sets come from
+	PipelineCache					m_pipelineCache;						// every pipeline, saved to disk at shutdown
 
 	// Shader modules
 	VkShaderModule					m_vertexShader		= nullptr;
 	VkShaderModule					m_pixelShader		= nullptr;
+	VkShaderModule					m_cullShader		= nullptr;
+	ShaderCache						m_shaderCache;							// compiled SPIR-V kept on disk between runs
+
+	// Everything one loaded level owns. There are two so the next level can be built while the current
+	// one renders, a replaced level is cleaned up once every frame that drew it has finished.
+	struct LEVEL
+	{
+		GameLevelData				data;
+		std::vector<Model>			models;
+		DrawList					drawList;						// scene-wide instance/material/draw tables and the prebuilt indirect draw commands
+		FrustumCuller				culler;							// drops draws outside the view frustum, with a compute pass or a SIMD sphere test on the CPU
+		GW::MATH::GVECTORF			pointColor			= {};
+		bool						live				= false;		// owns GPU resources
+		uint64_t					lastFrame			= 0;			// last frame that draws it once it's replaced
+		uint64_t					id					= 0;			// new for every load into the slot
+		uint32_t					arena				= 0;			// which of m_arenas its draws point into
+	};
+	LEVEL							m_levels[2];
+	uint32_t						m_current			= 0;
 
-	// Models
-	std::vector<Model>				m_models;
+	// Frames the CPU may get ahead of the GPU, each with its own fence and per-frame resources
+	unsigned int					m_framesInFlight	= DEFAULT_FRAMES_IN_FLIGHT;
+	FrameContexts					m_frames;
+
+	// Stages 1 and 2 of a level load, done in the background after F1
+	struct PREPARED_LEVEL
+	{
+		std::string path;
+		LEVEL_REQUEST request;
+		std::vector<std::shared_ptr<MeshAsset>> assets;	// parallel to request.meshes
+		double parse = 0, decode = 0;
+		bool loaded = false;							// parsed, and at least one of its meshes decoded
+	};
+	std::future<PREPARED_LEVEL>		m_nextLevel;
+
+	// Stage 3 copies (meshes and draw commands) of the level being swapped in, polled at each frame boundary
+	StagingBatch					m_levelUpload;
+	bool							m_swapPending		= false;		// the other slot is loaded, waiting for its upload
+
+	bool							m_indirectDraws		= true;			// one vkCmdDrawIndexedIndirect instead of a draw per batch
+	enum CULL_MODE { CULL_GPU, CULL_CPU, CULL_OFF };
+	CULL_MODE						m_cullMode			= CULL_GPU;		// CULL_GPU falls back to the CPU when unsupported
+
+	// Direct draws of large levels can be recorded on several threads into secondary command buffers (see RecordParallel).
+	// Off by default: it restarts the pass every frame, and no device has shown that to pay off yet (measure it with
+	// the headless benchmark). The batch cutoff is a guess as well.
+	static const uint32_t			PARALLEL_MIN_BATCHES = 256;			// fewest batches worth a thread
+	ParallelRecorder				m_recorder;
+	bool							m_parallelRecording	= false;
+	VkClearValue					m_clearValues[2];					// what the surface's StartFrame clears to
+
+	// The scene's binds and draws recorded once per level and image, re-executed while nothing they depend on changes
+	StaticCommands					m_staticScene;
+	bool							m_staticRecording	= true;
+	uint64_t						m_levelLoads		= 0;
+
+	// Unique meshes referenced by the level's models, all packed into one vertex and one index buffer.
+	// A second arena takes the next level when the current one's free space isn't enough, so nothing the GPU
+	// may still read ever moves.
+	MeshCache						m_meshCache;
+	GeometryArena					m_arenas[2];
+	uint32_t						m_arena				= 0;			// the one resident meshes live in
+
+	// Every buffer's memory is sub-allocated from a few large blocks
+	GpuAllocator					m_allocator;
+
+	// Camera, sun and point light data shared by every model
+	SHADER_SCENE_DATA				m_sceneData			= {};
+
+	// Per-frame GPU data (scene block) is sub-allocated from here, the scene block always fits a frame's slice
+	static const VkDeviceSize		UPLOAD_FRAME_SIZE	= 64 * 1024;
+	static_assert(sizeof(SHADER_SCENE_DATA) <= UPLOAD_FRAME_SIZE, "The scene block must fit one frame of the upload ring");
+	UploadRing						m_uploadRing;
+
+	// Bytes written to GPU buffers during the last Render, and when we last reported it
+	VkDeviceSize					m_uploadBytes		= 0;
+	uint32_t						m_visibleDraws		= 0;			// draws that survived culling in the last Render
+	uint32_t						m_totalDraws		= 0;
+	double							m_lastUploadReport	= 0.0;
+
+	// GPU timestamps around the scene pass and the cull dispatch (and each direct batch when asked)
+	GpuTimer						m_gpuTimer;
+	bool							m_gpuBatchTiming	= false;
 
 	// Camera matrices
 	GW::MATH::GMATRIXF				m_view;
 	GW::MATH::GMATRIXF				m_projection;
 
-	// Used to compute delta time
-	XTime							m_timer;
+	// Used to compute delta time, also keeps the recent frame times for percentiles
+	FrameTimer						m_timer;
 
 	// Flag for toggling level
 	bool m_levelFlag				= false;
@@ -52,49 +158,32 @@ class Renderer
 	unsigned int m_width, m_height	= 0;
 
 public:
-	Renderer(GW::SYSTEM::GWindow _win, GW::GRAPHICS::GVulkanSurface _vlk)
+	static const unsigned int DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+	// _drawIndirectCount: _vlk's device was created with VK_KHR_draw_indirect_count (GPU culling needs it)
+	// _framesInFlight is independent of the swapchain's image count: fewer lowers latency, more keeps the GPU busier
+	Renderer(GW::SYSTEM::GWindow _win, GW::GRAPHICS::GVulkanSurface _vlk, bool _drawIndirectCount,
+		unsigned int _framesInFlight = DEFAULT_FRAMES_IN_FLIGHT)
 	{
+		m_framesInFlight = _framesInFlight;
+
 		const char* musicPath = "../Assets/Audio/Dungeon.wav";
 		const char* soundPath = "../Assets/Audio/Success.wav";
 
-		// Get Client Dimensions 
+		// Draw into the window's swapchain
 		win = _win;
 		vlk = _vlk;
-
-		win.GetClientWidth(m_width);
-		win.GetClientHeight(m_height);
+		m_windowSurface.Create(win, vlk, _drawIndirectCount);
+		m_surface = &m_windowSurface;
 
 		// Enable proxies
-		m_vecMathProxy.Create();
-		m_mxMathProxy.Create();
 		m_inputProxy.Create(win);
 		m_controllerProxy.Create();
 		m_audio.Create();
 		m_sound.Create(soundPath, m_audio, 0.005f);		// it's very loud!
 		m_musicProxy.Create(musicPath, m_audio, 0.005f);
 
-		/* INITIALIZE SCENE DATA */
-		InitSceneData(vlk);
-
-		/***************** GEOMETRY INTIALIZATION ****************/
-		// Grab the device & physical device so we can allocate some stuff
-		VkPhysicalDevice physicalDevice = nullptr;
-		vlk.GetDevice((void**)&m_device);
-		vlk.GetPhysicalDevice((void**)&physicalDevice);
-
-		// Determine max frames and loop to initialize all buffers
-		// We give each frame its own buffer to avoid per-frame resource sharing issues
-		unsigned int maxFrames = 0;
-		vlk.GetSwapchainImageCount(maxFrames);
-		InitGeometry(physicalDevice, maxFrames);
-
-		/***************** SHADER INTIALIZATION ******************/
-		InitShaders();
-
-		/***************** PIPELINE INTIALIZATION ****************/
-		VkRenderPass renderPass;
-		vlk.GetRenderPass((void**)&renderPass);
-		InitPipeline(m_width, m_height, renderPass);
+		Init(LevelPath());
 
 		// Play looping background music
 		m_musicProxy.Play(true);
@@ -110,141 +199,168 @@ public:
 			});
 	}
 
-	void InitSceneData(GW::GRAPHICS::GVulkanSurface _vlk)
+	// No window, input or audio: draws _levelPath into _surface (e.g. a HeadlessSurface), which must outlive
+	// the renderer. The owner calls CleanUp before destroying the surface.
+	Renderer(RenderSurface& _surface, const std::string& _levelPath, unsigned int _framesInFlight = DEFAULT_FRAMES_IN_FLIGHT)
 	{
-		// Determine which level to load
-		std::string level;
-		if (m_levelFlag == false)
-			level = "../GameLevel.txt";
-		else
-			level = "../GameLevel2.txt";
+		m_framesInFlight = _framesInFlight;
+		m_surface = &_surface;
+		m_levelFlag = _levelPath == "../GameLevel2.txt";
+		Init(_levelPath);
+	}
 
-		// Separate out the per-level models into their own objects
-		LoadModels(m_models, level);
+	// Everything but the window, input and audio
+	void Init(const std::string& _levelPath)
+	{
+		m_width = m_surface->Width();
+		m_height = m_surface->Height();
 
-		// VIEW MATRIX
-		GW::MATH::GVECTORF eye { 0.75f, 2.0f,  3.0f };
-		GW::MATH::GVECTORF at  {-0.15f, 0.75f, 0.0f };
-		GW::MATH::GVECTORF up  { 0.0f,  1.0f,  0.0f };
-		m_mxMathProxy.LookAtLHF(eye, at, up, m_view);	// this performs the inverse operation
+		// Enable proxies
+		m_vecMathProxy.Create();
+		m_mxMathProxy.Create();
 
-		// PROJECTION MATRIX
-		_vlk.GetAspectRatio(m_ar);
-		m_fov = DegreesToRadians(65);
-		m_mxMathProxy.ProjectionVulkanLHF(m_fov, m_ar, 0.1f, 100.0f, m_projection);
+		// Asset decoding runs on these
+		m_workers.Create();
 
-		// LIGHTING INFO
-		GW::MATH::GVECTORF lightDir		{-1.0f,-1.0f,  2.0f,  0.0f };					// direction wants w = 0
-		GW::MATH::GVECTORF lightClr		{ 1.0f, 0.55f, 0.0f,  1.0f };					// orange tint
-		GW::MATH::GVECTORF lightAmbient { 0.25f,0.25f, 0.35f, 1.0f };
-		GW::MATH::GVECTORF pointColor1  { 1.0f, 0.23f, 0.033f,1.0f };
-		GW::MATH::GVECTORF pointColor2	{ 1.0f, 0.5f,  0.1f,  1.0f };
+		/* INITIALIZE SCENE DATA */
+		InitSceneData(m_surface->AspectRatio());
 
-		// Normalize light direction before sending to shaders
-		m_vecMathProxy.NormalizeF(lightDir, lightDir);
+		/***************** GEOMETRY INTIALIZATION ****************/
+		// Grab the device & physical device so we can allocate some stuff
+		VkPhysicalDevice physicalDevice = m_surface->PhysicalDevice();
+		m_device = m_surface->Device();
+		m_allocator.Create(m_device, physicalDevice);
+		for (auto& l : m_levels)
+			l.culler.Init(m_device, physicalDevice, m_surface->DrawIndirectCount());
+
+		// Every frame in flight gets its own copy of anything written per frame, guarded by its fence
+		m_frames.Create(m_device, m_surface->GraphicsQueue(), m_framesInFlight);
+		unsigned int maxFrames = m_frames.Count();
+		m_uploadRing.Create(m_allocator, UPLOAD_FRAME_SIZE, maxFrames);
+		m_gpuTimer.Create(m_device, physicalDevice, m_surface->GraphicsFamily(), maxFrames, 64);
+		m_gpuTimer.Scope("scene");								// ahead of the batch scopes each level registers
+		m_gpuTimer.Scope("cull");
+		if (m_surface->ContinuePass())
+		{
+			// Secondaries only ever run in a continue pass known to match the surface's pass
+			m_recorder.Create(m_device, m_surface->GraphicsFamily(), maxFrames);
+			m_staticScene.Create(m_device, m_surface->GraphicsFamily(), maxFrames);
+		}
+		m_sceneDescriptors.Create(m_device);
+		m_clearValues[0].color			= { {0.0f, 0.0f, 0.0f, 1.0f} };
+		m_clearValues[1].depthStencil	= { 1.0f, 0u };
 
-		// Take the view's position from world space (put it back in world space)
-		GW::MATH::GMATRIXF inverseView;
-		m_mxMathProxy.InverseF(m_view, inverseView);
-		GW::MATH::GVECTORF camPos = inverseView.row4;
+		/***************** SHADER INTIALIZATION ******************/
+		// Shaders and the graphics pipeline outlive level changes
+		m_shaderCache.Create("../ShaderCache");
+		m_pipelineCache.Create(physicalDevice, m_device, "../PipelineCache.bin");
+		InitShaders();
 
-		for (int i = 0; i < m_levelData.modelData.size(); ++i)
-		{
-			// Set each model's world matrix and scene data
-			m_models[i].m_sceneData.matricies[0]		= m_levelData.modelMatrices[i];
-
-			m_models[i].m_sceneData.sunDirection		= lightDir;
-			m_models[i].m_sceneData.sunColor			= lightClr;
-			m_models[i].m_sceneData.sunAmbient			= lightAmbient;
-			m_models[i].m_sceneData.camPos				= camPos;
-			m_models[i].m_sceneData.viewMatrix			= m_view;
-			m_models[i].m_sceneData.projMatrix			= m_projection;
-			m_models[i].m_sceneData.lightCount			= m_levelData.pLightPos.size(); // set number of lights to size of light vector
-
-			// Point light info
-			for (int j = 0; j < m_levelData.pLightPos.size(); ++j)
-			{
-				m_models[i].m_sceneData.pLightPos[j]	= m_levelData.pLightPos[j];  
+		/***************** FIRST LEVEL ***************************/
+		PREPARED_LEVEL first = PrepareLevel(_levelPath);
+		if (!first.loaded)
+			std::cout << "Renderer: Couldn't load " << _levelPath << ", nothing to draw" << std::endl;
+		LoadModels(Current(), first);
+		InitGeometry(m_current, maxFrames);
+		m_levelUpload.Wait();						// nothing else to draw yet
+		SetLevelLights(Current());
 
-				if (level == "../GameLevel.txt")
-					m_models[i].m_sceneData.pointCol	= pointColor1;
-				else 
-					m_models[i].m_sceneData.pointCol	= pointColor2;
-			}
-		}
+		/***************** PIPELINE INTIALIZATION ****************/
+		VkRenderPass renderPass = m_surface->RenderPass();
+		InitPipeline(m_width, m_height, renderPass);
+		std::cout << "Pipeline cache: " << (m_pipelineCache.IsWarm() ? "warm" : "cold") << ", graphics pipeline created in "
+			<< m_loadTimings.pipeline << " ms" << std::endl;
+		PrintLoadTimings();
+	}
 
-		// Set scenedata materials for each model/each material
-		for (auto &m : m_models)
-		{
-			for (int i = 0; i < m.m_mesh.materialCount; ++i)
-				m.m_sceneData.materials[i] = m.m_mesh.materials[i].attrib;
-		}
+	void InitSceneData(float _aspectRatio)
+	{
+		m_ar = _aspectRatio;
+		m_fov = DegreesToRadians(65);
+		m_sceneData = MakeSceneData(m_mxMathProxy, m_vecMathProxy, m_fov, m_ar, m_view, m_projection);
+	}
+
+	// Point lights of the level being drawn
+	void SetLevelLights(const LEVEL& _level)
+	{
+		SetSceneLights(m_sceneData, _level.data.pLightPos, _level.pointColor);
 	}
 
-	void InitGeometry(VkPhysicalDevice _physicalDevice, unsigned int _maxFrames)
+	// GPU side of a level load (stage 3) into level slot _slot, on the render thread
+	void InitGeometry(uint32_t _slot, unsigned int _maxFrames)
 	{
-		/* INITIALIZE VERTEX BUFFERS, INDEX BUFFERS, AND STORAGE BUFFERS*/
-		for (auto& m : m_models)
+		LEVEL& level = m_levels[_slot];
+		LEVEL& other = m_levels[1 - _slot];
+
+		/* INITIALIZE VERTEX BUFFERS AND INDEX BUFFERS (once per unique mesh) */
+		VkCommandPool commandPool = m_surface->CommandPool();
+		VkQueue graphicsQueue = m_surface->GraphicsQueue();
+		auto start = std::chrono::steady_clock::now();
+		// While the other level is still drawn only free space in its arena can be used. If that isn't enough
+		// the level goes into the other arena (free: the level that used it has been retired), nothing waits.
+		if (!m_meshCache.Upload(m_arenas[m_arena], m_allocator, m_levelUpload, !other.live))
 		{
-			m.CreateVertexBuffer(m_device, _physicalDevice);
-			m.CreateIndexBuffer(m_device, _physicalDevice);
-			m.CreateStorageBuffer(m_device, _physicalDevice, _maxFrames);
-
-			/* ***************** DESCRIPTOR SET ******************* */
-			m.InitDescriptorSetLayoutBindingAndCreateInfo(m_device);
-			m.InitDescriptorPoolCreateInfo(m_device, _maxFrames);
-			m.InitDescriptorSetAllocInfo(m_device, _maxFrames);
-			m.WriteDescriptorSet(m_device, _maxFrames);
+			std::vector<MeshAsset*> needed;
+			for (auto& m : level.models)
+				needed.push_back(m.m_mesh.get());
+			m_arena = 1 - m_arena;
+			m_meshCache.UploadFresh(m_arenas[m_arena], m_allocator, m_levelUpload, needed);
 		}
+		level.arena = m_arena;
+		m_loadTimings.upload = MillisecondsSince(start);
+		start = std::chrono::steady_clock::now();
+
+		/* INITIALIZE STORAGE BUFFERS AND DRAW COMMANDS (once per level) */
+		for (auto& m : level.models)
+			level.drawList.AddModel(*m.m_mesh, m.m_instances);
+		level.drawList.Create(m_allocator, m_levelUpload);
+		level.drawList.CreateScopes(m_gpuTimer);
+		m_levelUpload.SubmitAsync(m_allocator, commandPool, graphicsQueue);		// one submission, polled by UpdateLevels
+
+		/* ***************** DESCRIPTOR SET ******************* */
+		if (!level.drawList.CreateDescriptors(m_device, m_sceneDescriptors, m_uploadRing))
+			std::cout << "Renderer: No descriptor sets left for the level, it won't be drawn" << std::endl;
+
+		/* CULLING OUTPUTS */
+		level.culler.Create(m_allocator, level.drawList, m_surface->GraphicsFamily(), _maxFrames);
+		level.culler.CreatePipeline(m_device, m_cullShader, m_pipelineCache.Get());
+		level.live = true;
+		m_loadTimings.buffers = MillisecondsSince(start);
 	}
 
 	void InitShaders()
 	{
+		auto start = std::chrono::steady_clock::now();
 		std::string vertexShaderSource		= ShaderToString("../VertexShader.hlsl");
 		std::string pixelShaderSource		= ShaderToString("../PixelShader.hlsl");
+		std::string cullShaderSource		= ShaderToString("../CullShader.hlsl");
 
-		// Intialize runtime shader compiler HLSL->SPIRV
-		shaderc_compiler_t compiler			= shaderc_compiler_initialize();
-		shaderc_compile_options_t options	= shaderc_compile_options_initialize();
-		shaderc_compile_options_set_source_language(options, shaderc_source_language_hlsl);
-		shaderc_compile_options_set_invert_y(options, false); // enable/disable Y inversion
+		// HLSL->SPIRV, straight from the disk cache when nothing changed since the last run
+		std::vector<uint32_t> spirv;
 
-#ifndef NDEBUG
-		shaderc_compile_options_set_generate_debug_info(options);
-#endif
 		// VERTEX SHADER
-		shaderc_compilation_result_t result = shaderc_compile_into_spv( // compile
-			compiler, vertexShaderSource.c_str(), strlen(vertexShaderSource.c_str()),
-			shaderc_vertex_shader, "main.vert", "main", options);
-
-		if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success) // errors?
-			std::cout << "Vertex Shader Errors: " << shaderc_result_get_error_message(result) << std::endl;
-
-		GvkHelper::create_shader_module(m_device, shaderc_result_get_length(result), // load into Vulkan
-			(char*)shaderc_result_get_bytes(result), &m_vertexShader);
-
-		shaderc_result_release(result); // done
+		if (m_shaderCache.Get(vertexShaderSource, shaderc_vertex_shader, "main.vert", "main", spirv))
+			GvkHelper::create_shader_module(m_device, spirv.size() * 4, (char*)spirv.data(), &m_vertexShader); // load into Vulkan
 
 		// PIXEL SHADER
-		result = shaderc_compile_into_spv( // compile
-			compiler, pixelShaderSource.c_str(), strlen(pixelShaderSource.c_str()),
-			shaderc_fragment_shader, "main.frag", "main", options);
-
-		if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success) // errors?
-			std::cout << "Pixel Shader Errors: " << shaderc_result_get_error_message(result) << std::endl;
-
-		GvkHelper::create_shader_module(m_device, shaderc_result_get_length(result), // load into Vulkan
-			(char*)shaderc_result_get_bytes(result), &m_pixelShader);
-
-		shaderc_result_release(result); // done
-
-		// Free runtime shader compiler resources
-		shaderc_compile_options_release(options);
-		shaderc_compiler_release(compiler);
+		if (m_shaderCache.Get(pixelShaderSource, shaderc_fragment_shader, "main.frag", "main", spirv))
+			GvkHelper::create_shader_module(m_device, spirv.size() * 4, (char*)spirv.data(), &m_pixelShader);
+
+		// CULL (COMPUTE) SHADER
+		if (m_shaderCache.Get(cullShaderSource, shaderc_compute_shader, "main.comp", "main", spirv))
+			GvkHelper::create_shader_module(m_device, spirv.size() * 4, (char*)spirv.data(), &m_cullShader);
+
+		// Free runtime shader compiler resources (if a miss needed it)
+		m_shaderCache.CleanUp();
+		m_loadTimings.shaders = MillisecondsSince(start);
+		std::cout << "Shaders: " << m_shaderCache.Hits() << " from cache, " << m_shaderCache.Misses() << " compiled in "
+			<< m_loadTimings.shaders << " ms (" << (m_shaderCache.Misses() ? "cold" : "warm") << ")" << std::endl;
 	}
 
 	void InitPipeline(unsigned int _width, unsigned int _height, VkRenderPass &_renderPass)
 	{
+		auto start = std::chrono::steady_clock::now();
+
 		// Stage Info for vertex/fragment shaders
 		VkPipelineShaderStageCreateInfo stage_create_info[2] = {};
 		stage_create_info[0].sType							= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -370,19 +486,12 @@ public:
 
 		// descriptor set moved to loop // 
 
-		// Push constants let us send small amounts of data to the shaders, in this case our material/materialID from the fs logo meshes
-		VkPushConstantRange pushConstant = {};
-		pushConstant.offset									= 0;
-		pushConstant.size									= sizeof(uint32_t); // needs to be at least 128 bytes
-		pushConstant.stageFlags								= VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-
 		// Descriptor pipeline layout
 		VkPipelineLayoutCreateInfo pipeline_layout_create_info = {};
 		pipeline_layout_create_info.sType					= VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipeline_layout_create_info.setLayoutCount			= 1;
-		pipeline_layout_create_info.pSetLayouts				= &m_models[0].m_descriptorLayout;//VK_NULL_HANDLE;
-		pipeline_layout_create_info.pushConstantRangeCount	= 1;					// number of pushconstant ranges
-		pipeline_layout_create_info.pPushConstantRanges		= &pushConstant;
+		pipeline_layout_create_info.pSetLayouts				= &m_sceneDescriptors.Layout();		// shared by every level
+		pipeline_layout_create_info.pushConstantRangeCount	= 0;					// material and instance come from the draw table
 		vkCreatePipelineLayout(m_device, &pipeline_layout_create_info,
 			nullptr, &m_pipelineLayout);
 
@@ -403,31 +512,65 @@ public:
 		pipeline_create_info.renderPass						= _renderPass;
 		pipeline_create_info.subpass						= 0;
 		pipeline_create_info.basePipelineHandle				= VK_NULL_HANDLE;
-		vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1,
+		vkCreateGraphicsPipelines(m_device, m_pipelineCache.Get(), 1,
 			&pipeline_create_info, nullptr, &m_pipeline);
+		m_loadTimings.pipeline = MillisecondsSince(start);
 	}
 
 	void Render()
 	{
-		// Update specular component and view matrix
-		for (int i = 0; i < m_models.size(); ++i)
+		// Wait until the last frame that used this frame's resources is done on the GPU
+		unsigned int frame						= m_frames.Begin();
+
+		// Frame boundary: retire / swap levels before anything is recorded
+		UpdateLevels();
+		LEVEL& level							= Current();
+
+		// The surface's command buffer and framebuffer belong to the swapchain image, everything else to the frame
+		unsigned int currentImage				= m_surface->CurrentFrame();
+		VkQueue graphicsQueue					= m_surface->GraphicsQueue();
+
+		// Collect this frame's timestamps from its last use and reset them, ahead of the cull submission
+		m_gpuTimer.BeginFrame(frame, graphicsQueue);
+
+		// Update specular component and view matrix (once for the whole scene)
+		GW::MATH::GMATRIXF inverseView;
+		m_mxMathProxy.InverseF(m_view, inverseView);
+		m_sceneData.camPos						= inverseView.row4;
+		m_sceneData.viewMatrix					= m_view;
+
+		// Write it into this frame's slice of the upload ring (no map/unmap)
+		m_uploadRing.BeginFrame(frame);
+		uint32_t sceneOffset					= 0;
+		void* sceneMemory						= m_uploadRing.Allocate(sizeof(SHADER_SCENE_DATA), sceneOffset);
+		if (!sceneMemory)
+		{
+			// Never bind offset 0, it may be another frame's slice still in flight
+			std::cout << "Renderer: Scene block didn't fit the upload ring, writing it at the start of this frame's slice" << std::endl;
+			sceneMemory							= m_uploadRing.FrameStart(sceneOffset);
+		}
+		memcpy(sceneMemory, &m_sceneData, sizeof(SHADER_SCENE_DATA));
+		m_uploadBytes							= m_uploadRing.BytesUsed();		// the level's tables were uploaded once when it loaded
+
+		// Cull before the frame's command buffer is submitted (the compute pass goes ahead of it on the queue)
+		// (indirect: per placement and submesh, direct: whole batches with no visible placement are skipped)
+		bool indirect							= m_indirectDraws && level.drawList.SupportsIndirect();
+		bool culled								= m_cullMode != CULL_OFF;
+		if (culled)
 		{
-			GW::MATH::GMATRIXF inverseView;
-			m_mxMathProxy.InverseF(m_view, inverseView);
-			m_models[i].m_sceneData.camPos		= inverseView.row4;
-			m_models[i].m_sceneData.viewMatrix	= m_view;
+			GW::MATH::GMATRIXF viewProjection;
+			m_mxMathProxy.MultiplyMatrixF(m_view, m_projection, viewProjection);
+			if (indirect)
+				level.culler.Cull(frame, viewProjection, level.drawList, graphicsQueue, m_cullMode == CULL_GPU, &m_gpuTimer);
+			else
+				level.culler.CullInstances(viewProjection, level.drawList);
 		}
 
-		// Grab the current Vulkan commandBuffer
-		unsigned int currentBuffer;
-		vlk.GetSwapchainCurrentImage(currentBuffer);
-		VkCommandBuffer commandBuffer;
-		vlk.GetCommandBuffer(currentBuffer, (void**)&commandBuffer);
+		VkCommandBuffer commandBuffer			= m_surface->CommandBuffer(currentImage);
 
 		// What is the current client area dimensions?
-		unsigned int width, height;
-		win.GetClientWidth(width);
-		win.GetClientHeight(height);
+		unsigned int width						= m_surface->Width();
+		unsigned int height						= m_surface->Height();
 
 		// Setup the pipeline's dynamic settings
 		VkViewport viewport =
@@ -436,171 +579,298 @@ public:
 		};
 
 		VkRect2D scissor = { {0, 0}, {width, height} };
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+		uint32_t sceneScope						= m_gpuTimer.Scope("scene");
+		const uint8_t* visibleInstances			= culled && !indirect ? level.culler.InstanceVisibility() : nullptr;
+		// Only CPU culling makes the commands differ between frames (GPU culling writes the buffers they read)
+		bool gpuCulled							= culled && indirect && level.culler.UsedGpu();
+		// Both run in secondaries, which need a continue pass known to match the surface's, else everything is inline
+		bool secondaries						= SecondaryPass() != nullptr;
+		bool reuse								= secondaries && m_staticRecording && m_staticScene.IsCreated() && !m_gpuBatchTiming &&
+			(!culled || gpuCulled);
+		bool parallel							= secondaries && !reuse && m_parallelRecording && !indirect && m_recorder.IsCreated() &&
+			level.drawList.DrawCount(false) >= 2 * PARALLEL_MIN_BATCHES;
+		if (!level.drawList.HasDescriptors())
+			m_visibleDraws						= 0;					// its load failed to get descriptor sets
+		else if (reuse)
+			m_visibleDraws						= ExecuteStatic(level, commandBuffer, frame, currentImage, sceneOffset, viewport, scissor,
+				indirect, culled, sceneScope);
+		else if (parallel)
+			m_visibleDraws						= RecordParallel(level, commandBuffer, frame, currentImage, sceneOffset, viewport, scissor,
+				visibleInstances, sceneScope);
+		else
+		{
+			// Everything recorded into the render pass from here on (the pass's clear is Gateware's and not included)
+			m_gpuTimer.Begin(commandBuffer, sceneScope);
+			BindScene(level, commandBuffer, sceneOffset, viewport, scissor);
+
+			// Every (visible) draw at once
+			if (culled && indirect)
+			{
+				level.culler.Draw(commandBuffer, frame, level.drawList);
+				m_visibleDraws					= level.culler.VisibleCount();
+			}
+			else
+				m_visibleDraws					= level.drawList.Draw(commandBuffer, indirect, visibleInstances,
+					m_gpuBatchTiming ? &m_gpuTimer : nullptr);
+			m_gpuTimer.End(commandBuffer, sceneScope);
+		}
+		m_totalDraws							= level.drawList.DrawCount(indirect);
 
-		// Bind and draw each model
-		for (auto &m : m_models)
+#ifndef NDEBUG
+		// Report upload bandwidth and frame pacing about once a second
+		if (m_timer.TotalTime() - m_lastUploadReport >= 1.0)
 		{
-			m.BindBuffers(m_device, m_pipelineLayout, commandBuffer, currentBuffer);
-			m.Draw(m_pipelineLayout, commandBuffer);
+			std::cout << "Upload: " << m_uploadBytes << " bytes/frame, draws: " << m_visibleDraws << "/" << m_totalDraws << " visible";
+			if (culled && !(indirect && m_cullMode == CULL_GPU && level.culler.OnGpu()))
+				std::cout << ", CPU cull: " << level.culler.CpuMilliseconds() << " ms";
+			const GPU_FRAME_TIMES& gpu = m_gpuTimer.Latest();
+			if (sceneScope < gpu.scopes.size() && gpu.scopes[sceneScope] >= 0.0)
+				std::cout << ", GPU scene: " << gpu.scopes[sceneScope] << " ms";
+			if (parallel)
+				std::cout << ", parallel recording: " << m_recorder.Milliseconds() << " ms";
+			if (reuse)
+				std::cout << ", reused scene commands (" << m_staticScene.Recordings() << " recordings)";
+			std::cout << ", GPU wait: " << m_frames.WaitMilliseconds() << " ms (avg " << m_frames.AverageWaitMilliseconds()
+				<< " ms, " << m_frames.Count() << " frames in flight)";
+			FRAME_STATS frames = m_timer.Stats();
+			std::cout << ", frame p50/p95/p99/max: " << frames.p50 << "/" << frames.p95 << "/" << frames.p99 << "/" << frames.max << " ms";
+			std::cout << std::endl;
+			m_lastUploadReport = m_timer.TotalTime();
 		}
+#endif
+	}
+
+	// Camera for the next Render, for callers that drive it themselves instead of UpdateCamera
+	void SetView(const GW::MATH::GMATRIXF& _view) { m_view = _view; }
+
+	// Box around every placement's origin in the current level
+	void GetSceneBounds(GW::MATH::GVECTORF& _min, GW::MATH::GVECTORF& _max) const
+	{
+		const std::vector<GW::MATH::GMATRIXF>& matrices = m_levels[m_current].data.modelMatrices;
+		_min = _max = matrices.empty() ? GW::MATH::GVECTORF{} : matrices[0].row4;
+		for (auto& m : matrices)
+		{
+			_min = { (std::min)(_min.x, m.row4.x), (std::min)(_min.y, m.row4.y), (std::min)(_min.z, m.row4.z), 1.0f };
+			_max = { (std::max)(_max.x, m.row4.x), (std::max)(_max.y, m.row4.y), (std::max)(_max.z, m.row4.z), 1.0f };
+		}
+	}
+
+	// Bytes written to GPU buffers by the last Render call
+	VkDeviceSize GetFrameUploadBytes() const { return m_uploadBytes; }
+
+	// Draws submitted by the last Render call, and how many of them survived culling
+	// (GPU culling reports the count from the last time this frame context was rendered)
+	uint32_t GetFrameDrawCount() const { return m_totalDraws; }
+
+	// How long the last Render waited for its frame context to come back from the GPU
+	double GetFrameWaitMilliseconds() const { return m_frames.WaitMilliseconds(); }
+	uint32_t GetFrameVisibleCount() const { return m_visibleDraws; }
+
+	// GPU milliseconds per scope ("scene", "cull", "batch <n>") of the latest frame whose timestamps came back,
+	// which trails the current frame by about a swapchain length
+	const GPU_FRAME_TIMES& GetGpuFrameTimes() const { return m_gpuTimer.Latest(); }
+	const GpuTimer& GetGpuTimer() const { return m_gpuTimer; }
+
+	// Every frame's GPU times as they come back (nullptr stops), FlushGpuFrameTimes collects the last ones
+	void CollectGpuFrameTimes(std::vector<GPU_FRAME_TIMES>* _sink) { m_gpuTimer.Collect(_sink); }
+	void FlushGpuFrameTimes()
+	{
+		vkDeviceWaitIdle(m_device);
+		m_gpuTimer.ResolveAll();
+	}
+
+	// Also time each direct-mode batch on its own
+	void SetGpuBatchTiming(bool _enabled) { m_gpuBatchTiming = _enabled; }
+
+	// Start/stop writing every frame's GPU scope times to GpuTimings.csv
+	void ToggleGpuTimingCsv()
+	{
+		bool recording = !m_gpuTimer.IsRecording();
+		m_gpuTimer.RecordCsv(recording ? "../GpuTimings.csv" : nullptr);
+		std::cout << "GPU timings: " << (m_gpuTimer.IsRecording() ? "recording to ../GpuTimings.csv" : "not recording") << std::endl;
+	}
+
+	// Cycle frustum culling GPU -> CPU -> off (GPU is skipped when the device can't do it)
+	void ToggleCulling()
+	{
+		m_cullMode = static_cast<CULL_MODE>((m_cullMode + 1) % 3);
+		if (m_cullMode == CULL_GPU && !Current().culler.OnGpu())
+			m_cullMode = CULL_CPU;
+		const char* names[] = { "GPU", "CPU", "off" };
+		std::cout << "Culling: " << names[m_cullMode] << std::endl;
+	}
+
+	// Switch between one multi-draw indirect call and a direct draw per (model, submesh)
+	void ToggleIndirectDraws()
+	{
+		m_indirectDraws = !m_indirectDraws;
+		std::cout << "Draw mode: " << (m_indirectDraws && Current().drawList.SupportsIndirect() ? "indirect" : "direct") << std::endl;
+	}
+
+	// Record large levels' direct draws on one thread or several
+	void ToggleParallelRecording() { SetParallelRecording(!m_parallelRecording); }
+	void SetParallelRecording(bool _enabled)
+	{
+		m_parallelRecording = _enabled;
+		std::cout << "Recording: " << (m_parallelRecording ? "parallel (" + std::to_string(m_recorder.Parts()) + " threads, direct draws only)" :
+			std::string("render thread")) << (m_parallelRecording && !SecondaryPass() ? ", but the surface has no continue pass: inline" : "")
+			<< std::endl;
+	}
+
+	// Re-execute the scene's recorded commands while they still apply, or record them every frame
+	void ToggleStaticRecording()
+	{
+		m_staticRecording = !m_staticRecording;
+		std::cout << "Scene commands: " << (m_staticRecording ? "recorded once, reused (unless culled on the CPU)" : "recorded every frame")
+			<< (m_staticRecording && !m_staticScene.IsCreated() ? ", but the surface has no continue pass: recorded every frame" : "") << std::endl;
+	}
+
+	// Must match the clear values the surface's StartFrame is given (black and depth 1 unless set)
+	void SetClearValues(const VkClearValue _clearValues[2])
+	{
+		m_clearValues[0]						= _clearValues[0];
+		m_clearValues[1]						= _clearValues[1];
 	}
 
+	// Starts loading the other level in the background, Render swaps it in at the first frame boundary
+	// after it's ready. The current level keeps rendering meanwhile.
 	void ChangeLevel()
 	{
+		if (m_nextLevel.valid() || m_swapPending)
+			return;											// one is already on its way
+
 		// Play a sound upon changing the scene
 		m_sound.Play();
 
 		// Change the level flag
 		m_levelFlag = (false) ? m_levelFlag == true : m_levelFlag == false;
-			
-		// Finish current level's queue operations
-		CleanUp();
-
-		// Clear and re-initialize model data
-		m_levelData.modelData.clear();
-		m_levelData.modelMatrices.clear();
-		m_levelData.modelNames.clear();
-		m_levelData.pLightPos.clear();
-		m_models.clear();
-
-		// Re-initialize scene data
-		InitSceneData(vlk);
-		m_models.resize(m_models.size());
-
-		// Re-initialize geometry
-		VkPhysicalDevice physicalDevice = nullptr;
-		vlk.GetDevice((void**)&m_device);
-		vlk.GetPhysicalDevice((void**)&physicalDevice);
-		unsigned int maxFrames = 0;
-		vlk.GetSwapchainImageCount(maxFrames);
-		InitGeometry(physicalDevice, maxFrames);
-
-		InitShaders();
 
-		VkRenderPass renderPass;
-		vlk.GetRenderPass((void**)&renderPass);
-		InitPipeline(m_width, m_height, renderPass);
+		std::string path = LevelPath();
+		m_nextLevel = std::async(std::launch::async, [this, path]() { return PrepareLevel(path); });
 	}
 
 	void UpdateCamera()
 	{
 		m_timer.Signal();
 
-		// Set view matrix back to world space
-		GW::MATH::GMATRIXF viewCopy;
-		m_mxMathProxy.InverseF(m_view, viewCopy);
-
-		float delta							= m_timer.Delta();
-		float ychange						= 0.0f;				// represents how much we want the 'y' value to change this frame
-		const float camSpeed				= 2.0f;				// Represents how far we want the camera to be able to move over one second
-
 		// Vertical input states
 		float spacePressed					= 0.0f;
 		float lshiftPressed					= 0.0f;				// keyboard
 		float rtPressed						= 0.0f;
 		float ltPressed						= 0.0f;				// controller
-
-		// Get vertical input states
 		m_inputProxy.GetState(G_KEY_SPACE, spacePressed);
 		m_inputProxy.GetState(G_KEY_LEFTSHIFT, lshiftPressed);
 		m_controllerProxy.GetState(0, G_RIGHT_TRIGGER_AXIS, rtPressed);
 		m_controllerProxy.GetState(0, G_LEFT_TRIGGER_AXIS, ltPressed);
 
-		if (spacePressed || lshiftPressed || rtPressed || ltPressed)
-		{
-			// make the camera move on the Y
-			ychange = spacePressed - lshiftPressed + rtPressed - ltPressed;
-			viewCopy.row4.y += ychange * camSpeed * delta;
-		}
-
-		// Handle WASD movement
-		GW::MATH::GVECTORF translateMx;
-		float perFrameSpeed			= camSpeed * delta;
-		float xChange				= 0.0f;
-		float zChange				= 0.0f;
-
 		// wasd strafing keystates
-		float wPressed				= 0.0f;
-		float aPressed				= 0.0f;
-		float sPressed 				= 0.0f;
-		float dPressed				= 0.0f;
-
-		// left stick movement states
-		float lStickX				= 0.0f;
-		float lStickY				= 0.0f;
-
-		// WASD
+		float wPressed						= 0.0f;
+		float aPressed						= 0.0f;
+		float sPressed 						= 0.0f;
+		float dPressed						= 0.0f;
 		m_inputProxy.GetState(G_KEY_W, wPressed);
 		m_inputProxy.GetState(G_KEY_A, aPressed);
 		m_inputProxy.GetState(G_KEY_S, sPressed);
 		m_inputProxy.GetState(G_KEY_D, dPressed);
 
-		// Left controller stick
+		// left stick movement states
+		float lStickX						= 0.0f;
+		float lStickY						= 0.0f;
 		m_controllerProxy.GetState(0, G_LX_AXIS, lStickX);
 		m_controllerProxy.GetState(0, G_LY_AXIS, lStickY);
 
-		if (wPressed || aPressed || sPressed || dPressed || lStickX || lStickY)
-		{
-			zChange = wPressed - sPressed + lStickY;
-			xChange = dPressed - aPressed + lStickX;
+		CAMERA_INPUT input;
+		input.vertical						= spacePressed - lshiftPressed + rtPressed - ltPressed;
+		input.forward						= wPressed - sPressed + lStickY;
+		input.strafe						= dPressed - aPressed + lStickX;
 
-			translateMx = { xChange * perFrameSpeed, 0.0f, zChange * perFrameSpeed };
-			m_mxMathProxy.TranslateLocalF(viewCopy, translateMx, viewCopy);
-		}
+		// Mouse and right stick (yaw/pitch)
+		input.mouseMoved					= m_inputProxy.GetMouseDelta(input.mouseX, input.mouseY) == GW::GReturn::SUCCESS;
+		m_controllerProxy.GetState(0, G_RX_AXIS, input.stickX);
+		m_controllerProxy.GetState(0, G_RY_AXIS, input.stickY);
 
-		// Handle rotation (Yaw/Pitch)
 		unsigned int screenWidth, screenHeight;
 		win.GetClientWidth(screenWidth);
 		win.GetClientHeight(screenHeight);
 
-		float pi					= 3.14159f;
-		float thumbSpeed			= pi * delta;
-		float totalPitch			= 0.0f;
-		float totalYaw				= 0.0f;
-
-		// Right stick states
-		float rStickX				= 0.0f;
-		float rStickY				= 0.0f;
-
-		// Right controller stick
-		m_controllerProxy.GetState(0, G_RX_AXIS, rStickX);
-		m_controllerProxy.GetState(0, G_RY_AXIS, rStickY);
+		// The matrix work itself is in sceneData.h, where LevelRenderer_bench can time it
+		MoveCamera(m_mxMathProxy, m_view, input, static_cast<float>(m_timer.Delta()), m_fov, m_ar, screenWidth, screenHeight);
+	}
 
-		// Mouse deltas
-		float mX, mY = 0.0f;
+	// Stages 1 and 2 of a level load: parse it and decode its assets. Touches nothing the render thread
+	// uses (the worker pool is thread safe), so ChangeLevel runs it in the background.
+	PREPARED_LEVEL PrepareLevel(const std::string& _gameLevelPath)
+	{
+		PREPARED_LEVEL prepared;
+		prepared.path = _gameLevelPath;
+
+		// STAGE 1: what the level wants (prefer the pack LevelPacker built next to the text level)
+		auto start = std::chrono::steady_clock::now();
+		std::string packPath = _gameLevelPath.substr(0, _gameLevelPath.find_last_of('.')) + ".lvlpak";
+		bool parsed = LoadLevelPack(prepared.request, packPath) || ParseH2B(prepared.request, _gameLevelPath);
+		prepared.parse = MillisecondsSince(start);
+		if (!parsed)
+			return prepared;
+
+		// STAGE 2: map and decode every unique asset in parallel
+		start = std::chrono::steady_clock::now();
+		prepared.assets = MeshCache::DecodeAll(prepared.request.meshes, m_workers);
+		prepared.decode = MillisecondsSince(start);
+		for (auto& a : prepared.assets)
+			prepared.loaded = prepared.loaded || a != nullptr;
+		return prepared;
+	}
 
-		// Get mouse input
-		GW::GReturn res = m_inputProxy.GetMouseDelta(mX, mY);
-		if (res == GW::GReturn::SUCCESS && res != GW::GReturn::REDUNDANT || rStickY)
+	// Fills _level from a prepared load, populating a Model per unique mesh with every placement as an instance
+	void LoadModels(LEVEL& _level, PREPARED_LEVEL& _prepared)
+	{
+		m_loadTimings.parse = _prepared.parse;
+		_level.id = ++m_levelLoads;
+		m_loadTimings.decode = _prepared.decode;
+
+		// Meshes the cache already has replace the fresh copies (they may already be resident)
+		size_t cached = m_meshCache.Size();
+		std::vector<std::shared_ptr<MeshAsset>>& assets = _prepared.assets;
+		m_meshCache.Adopt(_prepared.request.meshes, assets);
+		m_loadTimings.decodedAssets = static_cast<uint32_t>(m_meshCache.Size() - cached);
+
+		// Drop placements whose mesh failed to load so names and matrices stay lined up
+		GameLevelData& data = _level.data;
+		const LEVEL_REQUEST& request = _prepared.request;
+		for (size_t i = 0; i < request.placementMesh.size(); ++i)
 		{
-			totalPitch = m_fov * mY / screenHeight + rStickY * -thumbSpeed; // -thumbspeed prevents inverted tilt
-			m_mxMathProxy.RotateXLocalF(viewCopy, totalPitch, viewCopy);
+			uint32_t mesh = request.placementMesh[i];
+			if (mesh >= assets.size() || assets[mesh] == nullptr)
+				continue;
+			data.modelNames.push_back(request.meshNames[mesh]);
+			data.modelData.push_back(assets[mesh]);
+			data.modelMatrices.push_back(request.placementMatrices[i]);
 		}
+		data.pLightPos = request.lights;
 
-		//  Yaw rotation
-		if (res == GW::GReturn::SUCCESS && res != GW::GReturn::REDUNDANT || rStickX)
+		// Model collecting instances for each mesh
+		std::unordered_map<const MeshAsset*, size_t> batch;
+		for (int i = 0; i < data.modelData.size(); ++i)
 		{
-			totalYaw = m_fov * m_ar * mX / screenWidth + rStickX * thumbSpeed;
-			m_mxMathProxy.RotateYGlobalF(viewCopy, totalYaw, viewCopy);
-		}
-
-		// Set back to view space
-		m_mxMathProxy.InverseF(viewCopy, m_view);
-	}
+			const MeshAsset* asset = data.modelData[i].get();
+			auto found = batch.find(asset);
 
-	// Runs the parser and populates a vector of Models
-	void LoadModels(std::vector<Model>& _models, std::string _gameLevelPath)
-	{
-		ParseH2B(m_levelData, _gameLevelPath);
-		for (int i = 0; i < m_levelData.modelData.size(); ++i)
-		{
-			Model temp;
-			temp.m_mesh = m_levelData.modelData[i];
-			_models.push_back(temp);
+			// Start a new model the first time we see a mesh
+			if (found == batch.end())
+			{
+				_level.models.emplace_back();
+				_level.models.back().m_mesh = data.modelData[i];	// shares the cached asset, no copy
+				found = batch.emplace(asset, _level.models.size() - 1).first;
+			}
+			_level.models[found->second].AddInstance(data.modelMatrices[i]);
 		}
+
+		GW::MATH::GVECTORF pointColor1  { 1.0f, 0.23f, 0.033f,1.0f };
+		GW::MATH::GVECTORF pointColor2	{ 1.0f, 0.5f,  0.1f,  1.0f };
+		if (_prepared.path == "../GameLevel.txt")
+			_level.pointColor					= pointColor1;
+		else
+			_level.pointColor					= pointColor2;
 	}
 
 	void PauseMusic() { m_musicProxy.Pause(); }
@@ -625,145 +895,232 @@ public:
 
 	void CleanUp()
 	{
+		// A background load still uses the workers and the mesh cache's sources
+		if (m_nextLevel.valid())
+			m_nextLevel.wait();
+		m_levelUpload.Wait();
+
 		// wait till everything has completed
 		vkDeviceWaitIdle(m_device);
 
+		for (auto& l : m_levels)
+			CleanUpLevel(l);
+		m_gpuTimer.CleanUp();
+		m_recorder.CleanUp();
+		m_staticScene.CleanUp();
+		m_frames.CleanUp();
+		m_sceneDescriptors.CleanUp();
+
 		// Clean up shaders
 		vkDestroyShaderModule(m_device, m_vertexShader, nullptr);
 		vkDestroyShaderModule(m_device, m_pixelShader, nullptr);
+		vkDestroyShaderModule(m_device, m_cullShader, nullptr);
 
-		// Clean up vertex/index buffers, etc.
-		for (auto& m : m_models)
-			m.CleanUpModelData(m_device);
+		// Clean up scene data
+		m_uploadRing.CleanUp(m_allocator);
 
 		// Clean up pipeline
 		vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
 		vkDestroyPipeline(m_device, m_pipeline, nullptr);
+
+		// Keep what the driver compiled for the next run
+		m_pipelineCache.Save(m_device);
+		m_pipelineCache.CleanUp(m_device);
+
+		// Clean up the shared vertex/index buffers
+		m_meshCache.CleanUp();
+		for (auto& a : m_arenas)
+			a.CleanUp(m_allocator);
+
+		// Return every block to Vulkan (reports anything that was never freed)
+		m_allocator.CleanUp();
 	}
 
 private:
-	void ParseH2B(GameLevelData& _data, std::string& _filePath)
-	{
-		H2B::Parser p;
-		std::string line				= " ";
-		std::string prevName			= " ";
-		std::string ignore[2]			= { "<Matrix" , "4x4" };
-		GW::MATH::GMATRIXF tempMatrix	= { 0 };
-		int ndx							= 0;
-		std::vector<std::string> tempNames;
+	LEVEL& Current() { return m_levels[m_current]; }
 
-		std::ifstream file{ _filePath, std::ios::in };		// Open file
+	std::string LevelPath() const { return m_levelFlag ? "../GameLevel2.txt" : "../GameLevel.txt"; }
 
-		if (!file.is_open())
-			std::cout << "ParseH2B: Could not open file!\n" << "Path: " << _filePath << std::endl;
-		else
+	// Once per frame before anything is recorded, never blocks: makes the next level current once its upload has
+	// finished, cleans up a replaced level once the last frame that drew it is done on the GPU, then starts
+	// uploading the next level if its background load has finished
+	void UpdateLevels()
+	{
+		if (m_swapPending && m_levelUpload.Poll())
+			FinishSwap();
+		if (m_swapPending)
+			return;
+
+		LEVEL& other = m_levels[1 - m_current];
+		if (other.live && m_frames.Completed() >= other.lastFrame)
 		{
-			// GET NAMES
-			while (!file.eof())
-			{
-				std::getline(file, line);
-				if (line == "MESH")							// If we find the mesh
-				{
-					std::getline(file, line, '.');			// Get the next line to retrieve the mesh name
-					tempNames.push_back(line);
-					std::getline(file, line);
-				}
-			}
+			CleanUpLevel(other);
+			if (other.arena != m_arena)
+				m_arenas[other.arena].CleanUp(m_allocator);		// every mesh moved to the new arena
+			m_meshCache.ReleaseUnused(m_arenas[m_arena]);		// meshes the previous level used but this one doesn't
 		}
-		file.clear();
-		file.seekg(0);
-		// GET MATRIX DATA
-		while (!file.eof())									// enter an infinite loop (exit if nothing to read)
-		{
-			std::getline(file, line);						// read current line of text up to the new line
-			if (line == "MESH")								// check if you found mesh
+		if (m_nextLevel.valid() && !other.live && m_nextLevel.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			StartSwap();
+	}
+
+	// Dynamic state, pipeline, geometry and tables every scene draw needs (once per command buffer).
+	// Only records into _commandBuffer, so it may run on several threads at once.
+	void BindScene(LEVEL& _level, VkCommandBuffer _commandBuffer, uint32_t _sceneOffset,
+		const VkViewport& _viewport, const VkRect2D& _scissor)
+	{
+		vkCmdSetViewport(_commandBuffer, 0, 1, &_viewport);
+		vkCmdSetScissor(_commandBuffer, 0, 1, &_scissor);
+		vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+
+		// Every mesh lives in the same vertex/index buffers
+		m_arenas[_level.arena].Bind(_commandBuffer);
+
+		// One descriptor set for the whole scene
+		_level.drawList.Bind(m_pipelineLayout, _commandBuffer, _sceneOffset);
+	}
+
+	// Direct draws split into contiguous batch ranges, each recorded on its own thread into a secondary command
+	// buffer. Returns the number of draws.
+	uint32_t RecordParallel(LEVEL& _level, VkCommandBuffer _commandBuffer, unsigned int _frame, unsigned int _image, uint32_t _sceneOffset,
+		const VkViewport& _viewport, const VkRect2D& _scissor, const uint8_t* _visibleInstances, uint32_t _sceneScope)
+	{
+		VkRenderPass renderPass					= SecondaryPass();
+		VkFramebuffer framebuffer				= m_surface->Framebuffer(_image);
+		uint32_t batches						= _level.drawList.DrawCount(false);
+		uint32_t parts = m_recorder.Record(_frame, renderPass, framebuffer, batches, PARALLEL_MIN_BATCHES,
+			[&](VkCommandBuffer _secondary, uint32_t _part, uint32_t _first, uint32_t _end) -> uint32_t
 			{
-				std::getline(file, line);					// Skip name line to get to the matrix
-				for (int i = 0; i < 4; ++i)					// loop through each row
-				{
-					char temp[250];
-					char* getfloat;
-
-					std::getline(file, line);				// Get the 'i'th row of the matrix
-					strcpy(temp, line.c_str());				// convert line to char*
-					getfloat = strtok(temp, " (,)");		// Get first token in the row
-
-					while (getfloat != NULL)				// walk through the rest of the tokens in the row
-					{
-						if (getfloat != ignore[0] && getfloat != ignore[1])
-						{
-							float stof = atof(getfloat);
-							tempMatrix.data[ndx] = stof;
-							ndx++; // only increment ndx if we put something in it
-						}
-						getfloat = strtok(NULL, " (,)>");	// Get next token
-
-						// Once the last element is filled, push into vector and reset
-						if (ndx == 16)
-						{
-							_data.modelMatrices.push_back(tempMatrix);
-							tempMatrix = { 0 };
-							ndx = 0;
-						}
-					} // Walk through Token
-				} // For every row in the Matrix
-			} // if "MESH"
-
-			if (line == "LIGHT")							// if you found light
+				// The scene scope runs from the first part to the end of the last (the primary may only execute
+				// commands in this pass), batch scopes are skipped since End marks them in the timer, which isn't thread safe
+				if (_part == 0)
+					m_gpuTimer.Begin(_secondary, _sceneScope);
+				BindScene(_level, _secondary, _sceneOffset, _viewport, _scissor);
+				uint32_t drawn					= _level.drawList.DrawBatches(_secondary, _first, _end, _visibleInstances);
+				if (_end == batches)
+					m_gpuTimer.End(_secondary, _sceneScope);
+				return drawn;
+			});
+
+		ExecuteSecondaries(_commandBuffer, framebuffer, _scissor, parts, m_recorder.Buffers(_frame));
+		return m_recorder.Total();
+	}
+
+	// Re-executes the frame's recorded scene, recording it first when the level, the viewport, the draw mode or the
+	// scene block's offset changed since. The recording doesn't name a framebuffer, so it runs on any swapchain image,
+	// inside the surface's continue pass (only called when there is one, see ExecuteSecondaries).
+	// Returns the number of draws.
+	uint32_t ExecuteStatic(LEVEL& _level, VkCommandBuffer _commandBuffer, unsigned int _frame, unsigned int _image, uint32_t _sceneOffset,
+		const VkViewport& _viewport, const VkRect2D& _scissor, bool _indirect, bool _culled, uint32_t _sceneScope)
+	{
+		std::vector<uint64_t> key				= { _level.id, (uint64_t)m_pipeline, _scissor.extent.width, _scissor.extent.height,
+			_sceneOffset, _indirect, _culled, _level.drawList.DrawCount(_indirect) };
+		VkCommandBuffer scene = m_staticScene.Get(_frame, SecondaryPass(), VK_NULL_HANDLE, key, [&](VkCommandBuffer _secondary)
 			{
-				std::getline(file, line);					// Skip name line to get to the matrix
-				for (int i = 0; i < 4; ++i)					// loop through each row
-				{
-					char temp[250];
-					char* getfloat;
-
-					std::getline(file, line);				// Get the 'i'th row of the matrix
-					strcpy(temp, line.c_str());				// convert line to char*
-					getfloat = strtok(temp, " (,)");		// Get first token in the row
-
-					while (getfloat != NULL)				// walk through the rest of the tokens in the row
-					{
-						if (getfloat != ignore[0] && getfloat != ignore[1])
-						{
-							float stof = atof(getfloat);
-							tempMatrix.data[ndx] = stof;
-							ndx++; // only increment ndx if we put something in it
-						}
-						getfloat = strtok(NULL, " (,)>");	// Get next token
-
-						// Once the last element is filled, push the last row into vector and reset
-						if (ndx == 16)
-						{
-							_data.pLightPos.push_back(tempMatrix.row4);
-							tempMatrix = { 0 };
-							ndx = 0;
-						}
-					} // Walk through Token
-				} // For every row in the Matrix
-			} // if "LIGHT"
-		} // !eof
-
-		// store actual names in mesh vector
-		for (int i = 0; i < tempNames.size(); ++i)
-		{
-			char* path = nullptr;
-			char tempPath[75];
+				m_gpuTimer.Begin(_secondary, _sceneScope);
+				BindScene(_level, _secondary, _sceneOffset, _viewport, _scissor);
+				if (_culled)
+					_level.culler.Draw(_secondary, _frame, _level.drawList);
+				else
+					_level.drawList.Draw(_secondary, _indirect);
+				m_gpuTimer.End(_secondary, _sceneScope);
+			});
+		m_gpuTimer.Reuse(_sceneScope);
 
-			_data.modelNames.push_back(tempNames[i]);
+		ExecuteSecondaries(_commandBuffer, m_surface->Framebuffer(_image), _scissor, 1, &scene);
+		return _culled ? _level.culler.VisibleCount() : _level.drawList.DrawCount(_indirect);
+	}
 
-			// check h2b path
-			std::string temp = "../Assets/";
-			temp.append(_data.modelNames[i]);
-			temp.append(".h2b");
+	// The pass secondaries run in: the surface's continue pass, nullptr when it has none known to be compatible
+	// (parallel recording and reuse are skipped then)
+	VkRenderPass SecondaryPass() const { return m_surface->ContinuePass(); }
 
-			strcpy(tempPath, temp.c_str());
-			path = tempPath;
+	// A subpass begun inline can't execute secondaries, so the surface's pass (nothing in it yet but its clear)
+	// is ended and the continue pass begun on the same framebuffer for secondaries. It keeps the cleared color and
+	// only clears depth (which the surface's pass doesn't store). The surface's EndFrame ends it as usual.
+	void ExecuteSecondaries(VkCommandBuffer _commandBuffer, VkFramebuffer _framebuffer, const VkRect2D& _renderArea,
+		uint32_t _count, const VkCommandBuffer* _secondaries)
+	{
+		vkCmdEndRenderPass(_commandBuffer);
+
+		// The second pass loads or clears the attachments the first one just wrote
+		VkMemoryBarrier barrier					= {};
+		barrier.sType							= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask					= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask					= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		vkCmdPipelineBarrier(_commandBuffer,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkRenderPassBeginInfo passInfo			= {};
+		passInfo.sType							= VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		passInfo.renderPass						= SecondaryPass();
+		passInfo.framebuffer					= _framebuffer;
+		passInfo.renderArea						= _renderArea;
+		passInfo.clearValueCount				= 2;
+		passInfo.pClearValues					= m_clearValues;
+		vkCmdBeginRenderPass(_commandBuffer, &passInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		vkCmdExecuteCommands(_commandBuffer, _count, _secondaries);
+	}
 
-			p.Parse(path);
-			_data.modelData.push_back(p);
-			prevName = _data.modelNames[i];
+	// Stage 3 of a background load: build the free slot and submit its upload, the current level keeps drawing
+	// (and stays current if the load failed)
+	void StartSwap()
+	{
+		PREPARED_LEVEL prepared = m_nextLevel.get();
+		if (!prepared.loaded)
+		{
+			// Don't trade a working level for an empty one
+			std::cout << "Renderer: Couldn't load " << prepared.path << ", keeping the current level" << std::endl;
+			m_levelFlag = !m_levelFlag;						// undo ChangeLevel's toggle, LevelPath names the current level again
+			return;
 		}
-		// All done!
-		file.close();
+		unsigned int maxFrames = m_frames.Count();
+
+		uint32_t next = 1 - m_current;
+		LoadModels(m_levels[next], prepared);
+		InitGeometry(next, maxFrames);
+		m_swapPending = true;
+	}
+
+	// The upload has finished: the frame being recorded is the first to draw the new level
+	void FinishSwap()
+	{
+		m_swapPending = false;
+		Current().lastFrame = m_frames.Frame() - 1;
+		m_current = 1 - m_current;
+		SetLevelLights(Current());
+
+		m_loadTimings.shaders = m_loadTimings.pipeline = 0;		// both are kept across levels
+		PrintLoadTimings();
+	}
+
+	// Release everything owned by one level (its frames must be done)
+	void CleanUpLevel(LEVEL& _level)
+	{
+		if (!_level.live)
+			return;
+
+		// Clean up storage buffers, draw commands, descriptors, etc.
+		_level.culler.CleanUp(m_device, m_allocator);
+		_level.drawList.CleanUp(m_allocator, m_sceneDescriptors);
+		_level.models.clear();
+		_level.data = {};
+		_level.live = false;
+	}
+
+	static double MillisecondsSince(std::chrono::steady_clock::time_point _start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+	}
+
+	void PrintLoadTimings() const
+	{
+		const LOAD_TIMINGS& t = m_loadTimings;
+		std::cout << "Level load: parse " << t.parse << " ms, decode " << t.decode << " ms (" << t.decodedAssets
+			<< " assets on " << m_workers.Size() << " threads), upload " << t.upload << " ms, buffers/descriptors "
+			<< t.buffers << " ms, shaders " << t.shaders << " ms, pipeline " << t.pipeline << " ms, total "
+			<< t.parse + t.decode + t.upload + t.buffers + t.shaders + t.pipeline << " ms" << std::endl;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+// Organize storage buffer data to send to shaders
+#define MAX_POINT_LIGHTS 16
+
+// Helper func 
+inline float DegreesToRadians(float _angle)
+{
+	return _angle * (3.14f / 180.0f);
+}
+
+// Globally shared scene data, one small block per frame instead of a copy inside every model
+struct SHADER_SCENE_DATA
+{
+	GW::MATH::GVECTORF		sunDirection, sunColor, sunAmbient, camPos, pointCol;			// light info
+	GW::MATH::GMATRIXF		viewMatrix, projMatrix;											// view info
+	GW::MATH::GVECTORF      pLightPos[MAX_POINT_LIGHTS];									// point lights in the scene
+	int lightCount;
+};
+
+// Starting camera, projection and sun of every scene (point lights come from the level, see SetSceneLights)
+inline SHADER_SCENE_DATA MakeSceneData(GW::MATH::GMatrix& _matrixMath, GW::MATH::GVector& _vectorMath, float _fov, float _aspectRatio,
+	GW::MATH::GMATRIXF& _view, GW::MATH::GMATRIXF& _projection)
+{
+	// VIEW MATRIX
+	GW::MATH::GVECTORF eye { 0.75f, 2.0f,  3.0f };
+	GW::MATH::GVECTORF at  {-0.15f, 0.75f, 0.0f };
+	GW::MATH::GVECTORF up  { 0.0f,  1.0f,  0.0f };
+	_matrixMath.LookAtLHF(eye, at, up, _view);	// this performs the inverse operation
+
+	// PROJECTION MATRIX
+	_matrixMath.ProjectionVulkanLHF(_fov, _aspectRatio, 0.1f, 100.0f, _projection);
+
+	// LIGHTING INFO
+	GW::MATH::GVECTORF lightDir		{-1.0f,-1.0f,  2.0f,  0.0f };					// direction wants w = 0
+	GW::MATH::GVECTORF lightClr		{ 1.0f, 0.55f, 0.0f,  1.0f };					// orange tint
+	GW::MATH::GVECTORF lightAmbient { 0.25f,0.25f, 0.35f, 1.0f };
+
+	// Normalize light direction before sending to shaders
+	_vectorMath.NormalizeF(lightDir, lightDir);
+
+	// Take the view's position from world space (put it back in world space)
+	GW::MATH::GMATRIXF inverseView;
+	_matrixMath.InverseF(_view, inverseView);
+
+	// Scene data is shared by every model
+	SHADER_SCENE_DATA scene					= {};
+	scene.sunDirection						= lightDir;
+	scene.sunColor							= lightClr;
+	scene.sunAmbient						= lightAmbient;
+	scene.camPos							= inverseView.row4;
+	scene.viewMatrix						= _view;
+	scene.projMatrix						= _projection;
+	return scene;
+}
+
+// Point lights of the level being drawn (the first MAX_POINT_LIGHTS of them)
+inline void SetSceneLights(SHADER_SCENE_DATA& _scene, const std::vector<GW::MATH::GVECTORF>& _lights, const GW::MATH::GVECTORF& _color)
+{
+	_scene.lightCount						= (std::min)((int)_lights.size(), MAX_POINT_LIGHTS);
+	for (int j = 0; j < _scene.lightCount; ++j)
+		_scene.pLightPos[j]					= _lights[j];
+	_scene.pointCol							= _color;
+}
+
+// One frame of camera input, gathered from the keyboard, mouse and controller by the caller
+struct CAMERA_INPUT
+{
+	float		vertical	= 0.0f;							// space/right trigger up, left shift/left trigger down
+	float		strafe		= 0.0f;							// D/A and the left stick
+	float		forward		= 0.0f;							// W/S and the left stick
+	float		mouseX		= 0.0f, mouseY = 0.0f;			// mouse delta in pixels
+	bool		mouseMoved	= false;
+	float		stickX		= 0.0f, stickY = 0.0f;			// right stick
+};
+
+// Flies _view by one frame of input: moves in view space, pitches about the local X and yaws about the world Y
+inline void MoveCamera(GW::MATH::GMatrix& _matrixMath, GW::MATH::GMATRIXF& _view, const CAMERA_INPUT& _input, float _delta,
+	float _fov, float _aspectRatio, unsigned int _screenWidth, unsigned int _screenHeight)
+{
+	const float camSpeed				= 2.0f;				// Represents how far we want the camera to be able to move over one second
+	const float thumbSpeed				= 3.14159f * _delta;
+
+	// Set view matrix back to world space
+	GW::MATH::GMATRIXF viewCopy;
+	_matrixMath.InverseF(_view, viewCopy);
+
+	if (_input.vertical)
+		viewCopy.row4.y += _input.vertical * camSpeed * _delta;
+
+	if (_input.strafe || _input.forward)
+	{
+		GW::MATH::GVECTORF translate	= { _input.strafe * camSpeed * _delta, 0.0f, _input.forward * camSpeed * _delta };
+		_matrixMath.TranslateLocalF(viewCopy, translate, viewCopy);
+	}
+
+	// Pitch
+	if (_input.mouseMoved || _input.stickY)
+	{
+		float totalPitch				= _fov * _input.mouseY / _screenHeight + _input.stickY * -thumbSpeed; // -thumbspeed prevents inverted tilt
+		_matrixMath.RotateXLocalF(viewCopy, totalPitch, viewCopy);
+	}
+
+	// Yaw
+	if (_input.mouseMoved || _input.stickX)
+	{
+		float totalYaw					= _fov * _aspectRatio * _input.mouseX / _screenWidth + _input.stickX * thumbSpeed;
+		_matrixMath.RotateYGlobalF(viewCopy, totalYaw, viewCopy);
+	}
+
+	// Set back to view space
+	_matrixMath.InverseF(viewCopy, _view);
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+// The one descriptor set layout and pool every level draws with, created once for the renderer.
+// Binding 0 is the scene data (dynamic offset into the upload ring), 1-3 the scene-wide instance, material and
+// draw tables, indexed in the shaders through each draw's DRAW_DATA entry. The tables never change, so each level
+// takes one set for every frame in flight and gives it back when it's cleaned up. The pool holds one per level slot
+// (the current one and the one being replaced) and never has to be recreated.
+class SceneDescriptors
+{
+	VkDevice						m_device			= nullptr;
+	VkDescriptorSetLayout			m_layout			= nullptr;
+	VkDescriptorPool				m_pool				= nullptr;
+
+public:
+	static const uint32_t			BINDING_COUNT		= 4;
+	static const uint32_t			MAX_LEVELS			= 2;
+
+	void Create(VkDevice _device)
+	{
+		m_device											= _device;
+		VkDescriptorSetLayoutBinding descriptorLayoutBinding[BINDING_COUNT] = {};
+		for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+		{
+			descriptorLayoutBinding[i].descriptorCount		= 1;
+			descriptorLayoutBinding[i].descriptorType		= Type(i);
+			descriptorLayoutBinding[i].stageFlags			= VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+			descriptorLayoutBinding[i].binding				= i;
+			descriptorLayoutBinding[i].pImmutableSamplers	= nullptr;
+		}
+
+		VkDescriptorSetLayoutCreateInfo descriptorCreateInfo = {};
+		descriptorCreateInfo.sType							= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		descriptorCreateInfo.bindingCount					= BINDING_COUNT;
+		descriptorCreateInfo.pBindings						= descriptorLayoutBinding;
+		vkCreateDescriptorSetLayout(_device, &descriptorCreateInfo, nullptr, &m_layout);
+
+		uint32_t maxSets									= MAX_LEVELS;
+		VkDescriptorPoolSize dpSize[2]						=
+		{
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, maxSets },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (BINDING_COUNT - 1) * maxSets }
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
+		descriptorPoolCreateInfo.sType						= VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolCreateInfo.flags						= VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;	// levels come and go
+		descriptorPoolCreateInfo.poolSizeCount				= 2;
+		descriptorPoolCreateInfo.pPoolSizes					= dpSize;
+		descriptorPoolCreateInfo.maxSets					= maxSets;
+		vkCreateDescriptorPool(_device, &descriptorPoolCreateInfo, nullptr, &m_pool);
+	}
+
+	const VkDescriptorSetLayout &Layout() const { return m_layout; }
+
+	static VkDescriptorType Type(uint32_t _binding)
+	{
+		return _binding == 0 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	}
+
+	// _count sets with the shared layout, empty if the pool is out of them
+	std::vector<VkDescriptorSet> Allocate(uint32_t _count)
+	{
+		std::vector<VkDescriptorSetLayout> layouts(_count, m_layout);
+		VkDescriptorSetAllocateInfo descriptorAllocInfo		= {};
+		descriptorAllocInfo.sType							= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptorAllocInfo.descriptorSetCount				= _count;
+		descriptorAllocInfo.pSetLayouts						= layouts.data();
+		descriptorAllocInfo.descriptorPool					= m_pool;
+		std::vector<VkDescriptorSet> sets(_count);
+		if (vkAllocateDescriptorSets(m_device, &descriptorAllocInfo, sets.data()) != VK_SUCCESS)
+		{
+			std::cout << "SceneDescriptors: Out of descriptor sets (more than " << MAX_LEVELS << " levels alive?)" << std::endl;
+			sets.clear();
+		}
+		return sets;
+	}
+
+	// The sets must not be in use any more
+	void Free(std::vector<VkDescriptorSet> &_sets)
+	{
+		if (!_sets.empty())
+			vkFreeDescriptorSets(m_device, m_pool, static_cast<uint32_t>(_sets.size()), _sets.data());
+		_sets.clear();
+	}
+
+	// Every level must have been cleaned up
+	void CleanUp()
+	{
+		if (m_pool)
+			vkDestroyDescriptorPool(m_device, m_pool, nullptr);		// frees whatever sets are left
+		if (m_layout)
+			vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+		m_pool												= nullptr;
+		m_layout											= nullptr;
+	}
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include "shaderc/shaderc.h"
+
+// Header of one cached SPIR-V file, followed by the code
+struct SPIRV_CACHE_HEADER
+{
+	char		magic[4];		// "SPVC"
+	uint32_t	version;		// SHADER_CACHE_VERSION
+	uint64_t	key;			// must match the name, guards against renamed or foreign files
+	uint64_t	codeSize;		// bytes of SPIR-V that follow
+};
+#define SHADER_CACHE_VERSION 1
+
+// Compiles HLSL to SPIR-V with shaderc, keeping every result in a directory so later runs
+// (and unchanged shaders) skip the compiler. Entries are named by a 64-bit FNV-1a hash of the source,
+// the stage, the entry point, the compile options and the shaderc SPIR-V version, so any change
+// simply misses and writes a new file. The compiler is only created on the first miss.
+class ShaderCache
+{
+	std::filesystem::path			m_directory;
+	shaderc_compiler_t				m_compiler			= nullptr;
+	shaderc_compile_options_t		m_options			= nullptr;
+	uint32_t						m_hits				= 0;
+	uint32_t						m_misses			= 0;
+
+public:
+	ShaderCache() = default;
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+	~ShaderCache() { CleanUp(); }
+
+	// An empty _directory disables the disk cache (everything is compiled)
+	void Create(const char* _directory)
+	{
+		m_directory = _directory;
+		std::error_code error;
+		if (!m_directory.empty())
+			std::filesystem::create_directories(m_directory, error);
+		if (error)
+		{
+			std::cout << "ShaderCache: Could not create \"" << _directory << "\": " << error.message() << std::endl;
+			m_directory.clear();
+		}
+	}
+
+	// Fills _spirv for the HLSL _source, from the cache when possible. Returns false on compile errors.
+	bool Get(const std::string& _source, shaderc_shader_kind _stage, const char* _inputName, const char* _entryPoint,
+		std::vector<uint32_t>& _spirv)
+	{
+		uint64_t key = Key(_source, _stage, _entryPoint);
+		std::filesystem::path path = EntryPath(key);
+		if (!m_directory.empty() && Read(path, key, _spirv))
+		{
+			++m_hits;
+			return true;
+		}
+
+		++m_misses;
+		if (!Compile(_source, _stage, _inputName, _entryPoint, _spirv))
+			return false;
+		if (!m_directory.empty())
+			Write(path, key, _spirv);
+		return true;
+	}
+
+	uint32_t Hits() const { return m_hits; }
+	uint32_t Misses() const { return m_misses; }
+
+	// Releases the compiler, the files stay
+	void CleanUp()
+	{
+		if (m_options)
+			shaderc_compile_options_release(m_options);
+		if (m_compiler)
+			shaderc_compiler_release(m_compiler);
+		m_options = nullptr;
+		m_compiler = nullptr;
+	}
+
+private:
+	// Everything that changes the output goes into the key
+	static bool DebugInfo()
+	{
+#ifndef NDEBUG
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static uint64_t Fnv1a(uint64_t _hash, const void* _data, size_t _size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(_data);
+		for (size_t i = 0; i < _size; ++i)
+		{
+			_hash ^= bytes[i];
+			_hash *= 0x100000001b3ull;
+		}
+		return _hash;
+	}
+
+	static uint64_t Key(const std::string& _source, shaderc_shader_kind _stage, const char* _entryPoint)
+	{
+		unsigned int spvVersion = 0, spvRevision = 0;
+		shaderc_get_spv_version(&spvVersion, &spvRevision);
+		uint32_t fields[] = { SHADER_CACHE_VERSION, uint32_t(_stage), DebugInfo() ? 1u : 0u,
+			uint32_t(shaderc_source_language_hlsl), 0u /* invert_y */, spvVersion, spvRevision };
+
+		uint64_t hash = 0xcbf29ce484222325ull;
+		hash = Fnv1a(hash, _source.data(), _source.size());
+		hash = Fnv1a(hash, fields, sizeof(fields));
+		hash = Fnv1a(hash, _entryPoint, strlen(_entryPoint) + 1);
+		return hash;
+	}
+
+	std::filesystem::path EntryPath(uint64_t _key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.spv", static_cast<unsigned long long>(_key));
+		return m_directory / name;
+	}
+
+	bool Compile(const std::string& _source, shaderc_shader_kind _stage, const char* _inputName, const char* _entryPoint,
+		std::vector<uint32_t>& _spirv)
+	{
+		if (m_compiler == nullptr)
+		{
+			// Intialize runtime shader compiler HLSL->SPIRV
+			m_compiler	= shaderc_compiler_initialize();
+			m_options	= shaderc_compile_options_initialize();
+			shaderc_compile_options_set_source_language(m_options, shaderc_source_language_hlsl);
+			shaderc_compile_options_set_invert_y(m_options, false); // enable/disable Y inversion
+			if (DebugInfo())
+				shaderc_compile_options_set_generate_debug_info(m_options);
+		}
+
+		shaderc_compilation_result_t result = shaderc_compile_into_spv( // compile
+			m_compiler, _source.c_str(), _source.size(), _stage, _inputName, _entryPoint, m_options);
+
+		bool compiled = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+		if (compiled)
+		{
+			size_t size = shaderc_result_get_length(result);
+			_spirv.resize(size / 4);
+			memcpy(_spirv.data(), shaderc_result_get_bytes(result), _spirv.size() * 4);
+		}
+		else
+			std::cout << _inputName << " Shader Errors: " << shaderc_result_get_error_message(result) << std::endl;
+
+		shaderc_result_release(result); // done
+		return compiled;
+	}
+
+	// A missing, truncated or mismatched entry is just a miss
+	static bool Read(const std::filesystem::path& _path, uint64_t _key, std::vector<uint32_t>& _spirv)
+	{
+		std::ifstream file(_path, std::ios_base::in | std::ios_base::binary);
+		if (!file.is_open())
+			return false;
+		SPIRV_CACHE_HEADER header = {};
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return false;
+		if (memcmp(header.magic, "SPVC", 4) != 0 || header.version != SHADER_CACHE_VERSION || header.key != _key ||
+			header.codeSize == 0 || header.codeSize % 4 != 0 || header.codeSize > (64ull << 20))
+			return false;
+		_spirv.resize(header.codeSize / 4);
+		if (!file.read(reinterpret_cast<char*>(_spirv.data()), header.codeSize) || _spirv[0] != 0x07230203u)
+		{
+			_spirv.clear();
+			return false;
+		}
+		return true;
+	}
+
+	// Written to a temporary name first and renamed over the entry, so a crash or a second instance
+	// never leaves a half written file under the real name
+	static void Write(const std::filesystem::path& _path, uint64_t _key, const std::vector<uint32_t>& _spirv)
+	{
+		SPIRV_CACHE_HEADER header = { { 'S', 'P', 'V', 'C' }, SHADER_CACHE_VERSION, _key, _spirv.size() * 4ull };
+		std::filesystem::path temp = _path;
+		temp += ".tmp";
+		{
+			std::ofstream file(temp, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(_spirv.data()), header.codeSize);
+			if (!file.good())
+			{
+				file.close();
+				std::error_code ignored;
+				std::filesystem::remove(temp, ignored);
+				std::cout << "ShaderCache: Could not write \"" << _path.string() << "\"" << std::endl;
+				return;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temp, _path, error);
+		if (error)
+		{
+			std::filesystem::remove(temp, error);
+			std::cout << "ShaderCache: Could not write \"" << _path.string() << "\"" << std::endl;
+		}
+	}
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SPHERESET_SSE
+#endif
+
+// World-space bounding spheres as structure of arrays, so the frustum test runs 4 (SSE) or 8 (AVX) spheres
+// per instruction. Arrays are padded with never-visible spheres to a whole number of lanes.
+class SphereSet
+{
+	static const uint32_t LANES = 8;				// padding granularity, covers both widths
+
+	std::vector<float>		m_x, m_y, m_z, m_r;
+	uint32_t				m_count			= 0;
+
+public:
+	// Move a mesh-space sphere by _world (row vectors), scaling its radius by the largest axis
+	void Push(const float _center[3], float _radius, const GW::MATH::GMATRIXF &_world)
+	{
+		const float* m	= _world.data;
+		float scale		= (std::max)((std::max)(m[0] * m[0] + m[1] * m[1] + m[2] * m[2],
+			m[4] * m[4] + m[5] * m[5] + m[6] * m[6]), m[8] * m[8] + m[9] * m[9] + m[10] * m[10]);
+
+		// overwrite the padding first, then re-pad
+		m_x.resize(m_count);
+		m_y.resize(m_count);
+		m_z.resize(m_count);
+		m_r.resize(m_count);
+		m_x.push_back(_center[0] * m[0] + _center[1] * m[4] + _center[2] * m[8] + m[12]);
+		m_y.push_back(_center[0] * m[1] + _center[1] * m[5] + _center[2] * m[9] + m[13]);
+		m_z.push_back(_center[0] * m[2] + _center[1] * m[6] + _center[2] * m[10] + m[14]);
+		m_r.push_back(_radius * std::sqrt(scale));
+		++m_count;
+
+		uint32_t padded = (m_count + LANES - 1) / LANES * LANES;
+		m_x.resize(padded, 0.0f);
+		m_y.resize(padded, 0.0f);
+		m_z.resize(padded, 0.0f);
+		m_r.resize(padded, -3.4e38f);				// fails every plane
+	}
+
+	uint32_t Count() const { return m_count; }
+
+	void Clear()
+	{
+		m_x.clear();
+		m_y.clear();
+		m_z.clear();
+		m_r.clear();
+		m_count = 0;
+	}
+
+	// Frustum test of every sphere (planes normalized, normals pointing inside).
+	// _visible receives 1/0 per sphere and must hold Count() rounded up to 8 entries. Returns how many are visible.
+	uint32_t Cull(const GW::MATH::GVECTORF _planes[6], uint8_t* _visible) const
+	{
+		uint32_t visible = 0;
+#if defined(__AVX__)
+		for (uint32_t i = 0; i < m_count; i += 8)
+		{
+			__m256 x		= _mm256_loadu_ps(&m_x[i]);
+			__m256 y		= _mm256_loadu_ps(&m_y[i]);
+			__m256 z		= _mm256_loadu_ps(&m_z[i]);
+			__m256 negR		= _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&m_r[i]));
+			__m256 inside	= _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p)
+			{
+				__m256 d	= _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(_planes[p].x)),
+					_mm256_mul_ps(y, _mm256_set1_ps(_planes[p].y))),
+					_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(_planes[p].z)), _mm256_set1_ps(_planes[p].w)));
+				inside		= _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+			}
+			visible			+= Store(_mm256_movemask_ps(inside), 8, _visible + i);
+		}
+#elif defined(SPHERESET_SSE)
+		for (uint32_t i = 0; i < m_count; i += 4)
+		{
+			__m128 x		= _mm_loadu_ps(&m_x[i]);
+			__m128 y		= _mm_loadu_ps(&m_y[i]);
+			__m128 z		= _mm_loadu_ps(&m_z[i]);
+			__m128 negR		= _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_r[i]));
+			__m128 inside	= _mm_cmpeq_ps(x, x);		// all ones (positions are never NaN)
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 d	= _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(_planes[p].x)),
+					_mm_mul_ps(y, _mm_set1_ps(_planes[p].y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(_planes[p].z)), _mm_set1_ps(_planes[p].w)));
+				inside		= _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+			}
+			visible			+= Store(_mm_movemask_ps(inside), 4, _visible + i);
+		}
+#else
+		for (uint32_t i = 0; i < m_count; ++i)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p)
+				inside = _planes[p].x * m_x[i] + _planes[p].y * m_y[i] + _planes[p].z * m_z[i] + _planes[p].w >= -m_r[i];
+			_visible[i] = inside ? 1 : 0;
+			visible += _visible[i];
+		}
+#endif
+		return visible;
+	}
+
+private:
+	// Spread a lane mask into one byte per sphere (padding lanes are always 0)
+	static uint32_t Store(int _mask, int _lanes, uint8_t* _out)
+	{
+		uint32_t count = 0;
+		for (int l = 0; l < _lanes; ++l)
+		{
+			_out[l] = (_mask >> l) & 1;
+			count += _out[l];
+		}
+		return count;
+	}
+};
@@ -0,0 +1,156 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include "gpuAllocator.h"
+
+// Collects buffer uploads and performs them through one staging buffer,
+// one command buffer and one queue submission (waited on, or polled through its fence)
+class StagingBatch
+{
+	struct COPY
+	{
+		VkBuffer		dst;
+		VkDeviceSize	dstOffset;
+		const void*		src;							// must stay valid until Submit/SubmitAsync
+		VkDeviceSize	size;
+		VkDeviceSize	stagingOffset;
+	};
+	std::vector<COPY>	m_copies;
+	VkDeviceSize		m_totalSize	= 0;
+
+public:
+	// Queue _size bytes from _src to be copied into _dst at _dstOffset
+	void Add(VkBuffer _dst, VkDeviceSize _dstOffset, const void* _src, VkDeviceSize _size)
+	{
+		if (_size == 0)
+			return;
+		m_copies.push_back({ _dst, _dstOffset, _src, _size, m_totalSize });
+		m_totalSize += (_size + 15) & ~VkDeviceSize(15);	// keep each copy 16 byte aligned in the staging buffer
+	}
+
+	bool Empty() const { return m_copies.empty(); }
+
+	// Copy everything queued so far, waits for the transfer to finish. Returns the number of bytes uploaded.
+	VkDeviceSize Submit(GpuAllocator &_allocator, VkCommandPool _commandPool, VkQueue _queue)
+	{
+		VkDeviceSize uploaded = SubmitAsync(_allocator, _commandPool, _queue);
+		Wait();
+		return uploaded;
+	}
+
+	// Copy everything queued so far in one submission that signals a fence, without waiting for it (the sources
+	// are read now and can go). Later work on _queue sees the copies. Poll or Wait releases the staging memory.
+	// Returns the number of bytes uploaded.
+	VkDeviceSize SubmitAsync(GpuAllocator &_allocator, VkCommandPool _commandPool, VkQueue _queue)
+	{
+		Wait();												// one submission in flight at a time
+		if (m_copies.empty())
+			return 0;
+		VkDevice device						= _allocator.GetDevice();
+
+		// Fill one staging buffer with every source
+		SUBMISSION &s						= m_submission;
+		s.allocator							= &_allocator;
+		s.commandPool						= _commandPool;
+		_allocator.CreateBuffer(m_totalSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&s.stagingBuffer, &s.stagingData);
+
+		for (auto &c : m_copies)
+			memcpy(s.stagingData.mapped + c.stagingOffset, c.src, static_cast<size_t>(c.size));
+
+		// Record every copy into a single command buffer
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool				= _commandPool;
+		allocInfo.level						= VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount		= 1;
+		vkAllocateCommandBuffers(device, &allocInfo, &s.commandBuffer);
+
+		VkCommandBufferBeginInfo beginInfo	= {};
+		beginInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags						= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(s.commandBuffer, &beginInfo);
+
+		for (auto &c : m_copies)
+		{
+			VkBufferCopy region				= { c.stagingOffset, c.dstOffset, c.size };	// src, dst, size
+			vkCmdCopyBuffer(s.commandBuffer, s.stagingBuffer, c.dst, 1, &region);
+		}
+
+		// Make the copies visible to any later vertex/index/storage/indirect reads on this queue (materials are read by the pixel shader)
+		VkMemoryBarrier barrier				= {};
+		barrier.sType						= VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask				= VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask				= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+			VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(s.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(s.commandBuffer);
+
+		// One submission, its fence says when the staging buffer can go
+		VkFenceCreateInfo fenceInfo			= {};
+		fenceInfo.sType						= VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		vkCreateFence(device, &fenceInfo, nullptr, &s.fence);
+
+		VkSubmitInfo submitInfo				= {};
+		submitInfo.sType					= VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount		= 1;
+		submitInfo.pCommandBuffers			= &s.commandBuffer;
+		vkQueueSubmit(_queue, 1, &submitInfo, s.fence);
+
+		VkDeviceSize uploaded = 0;
+		for (auto &c : m_copies)
+			uploaded += c.size;
+		m_copies.clear();
+		m_totalSize = 0;
+		return uploaded;
+	}
+
+	// Has the last SubmitAsync finished on the GPU? Releases its staging memory once it has. Never blocks.
+	bool Poll()
+	{
+		SUBMISSION &s						= m_submission;
+		if (s.fence == nullptr)
+			return true;
+		if (vkGetFenceStatus(s.allocator->GetDevice(), s.fence) != VK_SUCCESS)
+			return false;
+		Release();
+		return true;
+	}
+
+	// Blocks until the last SubmitAsync has finished, then releases its staging memory
+	void Wait()
+	{
+		if (m_submission.fence == nullptr)
+			return;
+		vkWaitForFences(m_submission.allocator->GetDevice(), 1, &m_submission.fence, VK_TRUE, UINT64_MAX);
+		Release();
+	}
+
+private:
+	// What a submission keeps alive until its fence signals
+	struct SUBMISSION
+	{
+		GpuAllocator*	allocator		= nullptr;
+		VkCommandPool	commandPool		= nullptr;
+		VkCommandBuffer	commandBuffer	= nullptr;
+		VkFence			fence			= nullptr;
+		VkBuffer		stagingBuffer	= nullptr;
+		GPU_ALLOCATION	stagingData;
+	};
+	SUBMISSION			m_submission;
+
+	void Release()
+	{
+		SUBMISSION &s						= m_submission;
+		VkDevice device						= s.allocator->GetDevice();
+		vkDestroyFence(device, s.fence, nullptr);
+		vkFreeCommandBuffers(device, s.commandPool, 1, &s.commandBuffer);
+		s.allocator->DestroyBuffer(s.stagingBuffer, s.stagingData);
+		s									= SUBMISSION();
+	}
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// One secondary command buffer per frame, recorded once and executed again every frame until what it was
+// recorded against changes. The caller describes that as a key, any difference re-records the frame's buffer.
+// A frame's buffer is only re-recorded when the frame comes around again (its last submission is done).
+class StaticCommands
+{
+	VkDevice							m_device			= nullptr;
+	VkCommandPool						m_commandPool		= nullptr;
+	std::vector<VkCommandBuffer>		m_buffers;							// per frame
+	std::vector<std::vector<uint64_t>>	m_keys;								// per frame, empty: never recorded
+	uint64_t							m_recordings		= 0;
+
+public:
+	void Create(VkDevice _device, uint32_t _queueFamily, uint32_t _frames)
+	{
+		m_device							= _device;
+		VkCommandPoolCreateInfo poolInfo	= {};
+		poolInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags						= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex			= _queueFamily;
+		vkCreateCommandPool(_device, &poolInfo, nullptr, &m_commandPool);
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool				= m_commandPool;
+		allocInfo.level						= VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount		= _frames;
+		m_buffers.resize(_frames);
+		vkAllocateCommandBuffers(_device, &allocInfo, m_buffers.data());
+		m_keys.assign(_frames, {});
+	}
+
+	bool IsCreated() const { return m_commandPool != nullptr; }
+
+	// The frame's buffer, first recorded with _record(commandBuffer) inside subpass 0 of _renderPass/_framebuffer
+	// if _key differs from the key it was last recorded with. It may only be executed in a pass compatible with
+	// _renderPass.
+	template <typename F>
+	VkCommandBuffer Get(unsigned int _frame, VkRenderPass _renderPass, VkFramebuffer _framebuffer, const std::vector<uint64_t>& _key,
+		const F& _record)
+	{
+		VkCommandBuffer commandBuffer		= m_buffers[_frame];
+		if (m_keys[_frame] == _key)
+			return commandBuffer;
+
+		VkCommandBufferInheritanceInfo inheritance = {};
+		inheritance.sType					= VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass				= _renderPass;
+		inheritance.subpass					= 0;
+		inheritance.framebuffer				= _framebuffer;
+
+		VkCommandBufferBeginInfo beginInfo	= {};
+		beginInfo.sType						= VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags						= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;	// reused, never one time
+		beginInfo.pInheritanceInfo			= &inheritance;
+
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);					// implicitly resets it
+		_record(commandBuffer);
+		vkEndCommandBuffer(commandBuffer);
+		m_keys[_frame]						= _key;
+		++m_recordings;
+		return commandBuffer;
+	}
+
+	// How many times a buffer has been (re-)recorded
+	uint64_t Recordings() const { return m_recordings; }
+
+	// The command buffers must not be in use any more
+	void CleanUp()
+	{
+		if (m_commandPool)
+			vkDestroyCommandPool(m_device, m_commandPool, nullptr);		// frees the command buffers
+		m_commandPool						= nullptr;
+		m_buffers.clear();
+		m_keys.clear();
+	}
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+// Fixed set of worker threads draining one FIFO of jobs. Submit hands back a future for the result.
+class ThreadPool
+{
+	std::vector<std::thread>			m_workers;
+	std::deque<std::function<void()>>	m_jobs;
+	std::mutex							m_mutex;
+	std::condition_variable				m_wake;
+	bool								m_stopping		= false;
+
+public:
+	ThreadPool() = default;
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool() { CleanUp(); }
+
+	// _threads = 0 uses one per hardware thread, leaving one for the render thread
+	void Create(unsigned int _threads = 0)
+	{
+		CleanUp();
+		if (_threads == 0)
+		{
+			unsigned int hardware = std::thread::hardware_concurrency();
+			_threads = hardware > 1 ? hardware - 1 : 1;
+		}
+		m_stopping = false;
+		for (unsigned int i = 0; i < _threads; ++i)
+			m_workers.emplace_back([this]() { Work(); });
+	}
+
+	unsigned int Size() const { return static_cast<unsigned int>(m_workers.size()); }
+
+	template <typename F>
+	auto Submit(F&& _job) -> std::future<decltype(_job())>
+	{
+		using RESULT = decltype(_job());
+		// packaged_task isn't copyable and std::function needs a copyable target
+		auto task = std::make_shared<std::packaged_task<RESULT()>>(std::forward<F>(_job));
+		std::future<RESULT> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.emplace_back([task]() { (*task)(); });
+		}
+		m_wake.notify_one();
+		return result;
+	}
+
+	// Finishes the queued jobs, then joins every worker
+	void CleanUp()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wake.notify_all();
+		for (auto& w : m_workers)
+			w.join();
+		m_workers.clear();
+	}
+
+private:
+	void Work()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+				if (m_jobs.empty())
+					return;							// stopping and drained
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+			job();
+		}
+	}
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include "gpuAllocator.h"
+
+// Linear allocator over one persistently mapped host-visible buffer, split into a segment per frame.
+// Each frame rewinds its own segment, so per-frame data costs a pointer bump and a memcpy,
+// and shaders reach it through dynamic descriptor offsets instead of separate buffers.
+class UploadRing
+{
+	VkBuffer					m_buffer			= nullptr;
+	GPU_ALLOCATION				m_memory;							// host-visible, so mapped for as long as it lives
+
+	VkDeviceSize				m_frameSize			= 0;			// bytes available to each frame
+	VkDeviceSize				m_alignment			= 1;			// minStorageBufferOffsetAlignment
+	VkDeviceSize				m_frameStart		= 0;			// current frame's segment
+	VkDeviceSize				m_head				= 0;			// next free byte
+
+public:
+	void Create(GpuAllocator &_allocator, VkDeviceSize _frameSize, unsigned int _maxFrames)
+	{
+		m_alignment		= _allocator.GetLimits().minStorageBufferOffsetAlignment;
+		m_frameSize		= AlignUp(_frameSize);
+
+		_allocator.CreateBuffer(m_frameSize * _maxFrames,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&m_buffer, &m_memory);
+	}
+
+	// Rewind to the start of this frame's segment (its previous contents are no longer in use by the GPU)
+	void BeginFrame(unsigned int _frame)
+	{
+		m_frameStart	= m_frameSize * _frame;
+		m_head			= m_frameStart;
+	}
+
+	// Reserve _size bytes for this frame, returns where to write them (nullptr if the segment is full)
+	// _offset receives the dynamic offset to bind the allocation with
+	void* Allocate(VkDeviceSize _size, uint32_t &_offset)
+	{
+		VkDeviceSize start = AlignUp(m_head);
+		if (start + _size > m_frameStart + m_frameSize)
+		{
+			std::cout << "UploadRing: Frame segment full!\n" << "Requested: " << _size << " bytes" << std::endl;
+			return nullptr;
+		}
+		m_head			= start + _size;
+		_offset			= static_cast<uint32_t>(start);
+		return m_memory.mapped + start;
+	}
+
+	// The start of this frame's segment, whatever was allocated there already
+	void* FrameStart(uint32_t &_offset) const
+	{
+		_offset			= static_cast<uint32_t>(m_frameStart);
+		return m_memory.mapped + m_frameStart;
+	}
+
+	VkBuffer GetBuffer() const { return m_buffer; }
+
+	// Bytes handed out so far this frame
+	VkDeviceSize BytesUsed() const { return m_head - m_frameStart; }
+
+	void CleanUp(GpuAllocator &_allocator)
+	{
+		_allocator.DestroyBuffer(m_buffer, m_memory);
+	}
+
+private:
+	VkDeviceSize AlignUp(VkDeviceSize _value) const
+	{
+		return (_value + m_alignment - 1) / m_alignment * m_alignment;
+	}
+};